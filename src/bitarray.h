@@ -7,6 +7,9 @@
 #ifndef BIT_ARRAY_H
 #define BIT_ARRAY_H
 
+#include <stdint.h>
+#include <immintrin.h>
+
 #define u64_bitarray(x)
 #define u32_bitarray(x)
 #define u16_bitarray(x)
@@ -144,4 +147,94 @@
 #define u08_bitarray_mask_at(x, k, mask)                                       \
         ((u08_bitarray_fetch_block(x, k) >> u08_bitarray_fetch_pos(k)) & mask) \
 
+/*******************************************************************************
+* NAME: u64_bitarray_popcount256
+* DESC: population count of each 64-bit block of an AVX2 vector through a 4-bit
+*       pshufb lookup table, the byte counts of each block are summed with a sum
+*       of absolute differences against 0
+* OUTP: four 64-bit counts
+* @ x : vector of four 64-bit blocks
+*******************************************************************************/
+static inline __m256i u64_bitarray_popcount256(const __m256i x)
+{
+    const __m256i lookup = _mm256_setr_epi8
+    (
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+    );
+    
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    
+    __m256i lo = _mm256_and_si256(x, low_mask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask);
+    
+    __m256i count = _mm256_add_epi8
+    (
+        _mm256_shuffle_epi8(lookup, lo),
+        _mm256_shuffle_epi8(lookup, hi)
+    );
+    
+    return _mm256_sad_epu8(count, _mm256_setzero_si256());
+}
+
+/*******************************************************************************
+* NAME: u64_bitarray_load
+* DESC: read 64 bits of an n-bit array starting at any bit position
+* OUTP: bits pos to pos + 63 in the low to high bits, bits at or beyond n may
+*       hold anything but no word past the end of the array is ever read
+* @ x : array
+* @ pos : bit index less than n
+* @ n : length of the array in bits
+*******************************************************************************/
+static inline uint64_t u64_bitarray_load
+(
+    const uint64_t *x, 
+    uint64_t pos, 
+    uint64_t n
+)
+{
+    const uint64_t offset = pos % 64;
+    uint64_t y = x[pos / 64] >> offset;
+    
+    if (offset != 0 && pos - offset + 64 < n) y |= x[pos / 64 + 1] << (64 - offset);
+    
+    return y;
+}
+
+/*******************************************************************************
+* NAME: u64_bitarray_load_cyclic
+* DESC: read 64 bits of an n-bit array treated as a ring, so that bit n - 1 is
+*       followed by bit 0. Short arrays wrap around more than once.
+* OUTP: bits pos to pos + 63 modulo n in the low to high bits
+* @ x : array
+* @ pos : bit index less than n
+* @ n : nonzero length of the array in bits
+*******************************************************************************/
+static inline uint64_t u64_bitarray_load_cyclic
+(
+    const uint64_t *x, 
+    uint64_t pos, 
+    uint64_t n
+)
+{
+    uint64_t y = 0;
+    uint64_t filled = 0;
+    uint64_t len;
+    
+    if (pos + 64 <= n) return u64_bitarray_load(x, pos, n);
+    
+    while (filled < 64)
+    {
+        len = n - pos < 64 - filled ? n - pos : 64 - filled;
+        y |= (u64_bitarray_load(x, pos, n) & (~0ULL >> (64 - len))) << filled;
+        
+        filled += len;
+        pos += len;
+        
+        if (pos == n) pos = 0;
+    }
+    
+    return y;
+}
+
 #endif
@@ -0,0 +1,110 @@
+/*
+* NAME: Copyright (c) 2020, Biren Patel
+* LISC: MIT License
+* DESC: Header-only hooks for the RNG_INSTRUMENT build. Every macro expands to a
+* no-op unless the library is compiled with -DRNG_INSTRUMENT.
+*/
+
+#ifndef INSTRUMENT_RANDOM_H
+#define INSTRUMENT_RANDOM_H
+
+#include "random_utils.h"
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#ifdef RNG_INSTRUMENT
+
+/*******************************************************************************
+* NAME: rng_usage_threshold
+* DESC: draws at which a random_t and a simd_random_t lane reach the fraction of
+*       their period set by rng_usage_limit
+*******************************************************************************/
+extern uint64_t rng_usage_threshold[2];
+
+/*******************************************************************************
+* NAME: rng_usage_add
+* DESC: count one call of a sampling function and the words it consumed
+* @ api : the sampling function
+* @ words : generator outputs consumed by the call, including nested calls
+*******************************************************************************/
+void rng_usage_add(const api_t api, const uint64_t words);
+
+/*******************************************************************************
+* NAME: rng_usage_warn
+* DESC: report a generator which has just reached the limit of rng_usage_limit
+* @ simd : 1 for a simd_random_t lane, else 0
+* @ draws : draws taken by the generator
+*******************************************************************************/
+void rng_usage_warn(const int simd, const uint64_t draws);
+
+/*******************************************************************************
+* NAME: INSTRUMENT_RESET
+* DESC: zero the draw count of a new generator
+* @ rng : pointer to random_t
+*******************************************************************************/
+#define INSTRUMENT_RESET(rng) (rng)->draws = 0
+#define SIMD_INSTRUMENT_RESET(rng) (rng)->draws = _mm256_setzero_si256()
+
+/*******************************************************************************
+* NAME: INSTRUMENT_DRAW
+* DESC: count one step of the generator and warn once when it reaches the limit
+* @ rng : pointer to random_t, or simd_random_t where every lane takes one step
+*******************************************************************************/
+#define INSTRUMENT_DRAW(rng)                                                    \
+    do                                                                          \
+    {                                                                           \
+        if (++(rng)->draws == rng_usage_threshold[0])                           \
+        {                                                                       \
+            rng_usage_warn(0, (rng)->draws);                                    \
+        }                                                                       \
+    }                                                                           \
+    while (0)
+
+#define SIMD_INSTRUMENT_DRAW(rng)                                               \
+    do                                                                          \
+    {                                                                           \
+        (rng)->draws = _mm256_add_epi64((rng)->draws, _mm256_set1_epi64x(1));   \
+                                                                                \
+        if ((uint64_t) _mm256_extract_epi64((rng)->draws, 0) == rng_usage_threshold[1]) \
+        {                                                                       \
+            rng_usage_warn(1, (uint64_t) _mm256_extract_epi64((rng)->draws, 0)); \
+        }                                                                       \
+    }                                                                           \
+    while (0)
+
+/*******************************************************************************
+* NAME: INSTRUMENT_BEGIN, INSTRUMENT_END
+* DESC: bracket the body of a sampling function to charge it with its words. A
+*       simd_random_t takes two steps per 256-bit simd_rng_next output.
+* @ api : api_t of the sampling function
+* @ rng : pointer to random_t or simd_random_t
+*******************************************************************************/
+#define INSTRUMENT_BEGIN(rng) const uint64_t instrument_start = (rng)->draws
+
+#define INSTRUMENT_END(api, rng) rng_usage_add(api, (rng)->draws - instrument_start)
+
+#define SIMD_INSTRUMENT_BEGIN(rng)                                              \
+    const uint64_t instrument_start = (uint64_t) _mm256_extract_epi64((rng)->draws, 0)
+
+#define SIMD_INSTRUMENT_END(api, rng)                                           \
+    rng_usage_add                                                               \
+    (                                                                           \
+        api,                                                                    \
+        ((uint64_t) _mm256_extract_epi64((rng)->draws, 0) - instrument_start) / 2 \
+    )
+
+#else
+
+#define INSTRUMENT_RESET(rng) (void) 0
+#define SIMD_INSTRUMENT_RESET(rng) (void) 0
+#define INSTRUMENT_DRAW(rng) (void) 0
+#define SIMD_INSTRUMENT_DRAW(rng) (void) 0
+#define INSTRUMENT_BEGIN(rng) (void) 0
+#define INSTRUMENT_END(api, rng) (void) 0
+#define SIMD_INSTRUMENT_BEGIN(rng) (void) 0
+#define SIMD_INSTRUMENT_END(api, rng) (void) 0
+
+#endif
+
+#endif
@@ -19,4 +19,7 @@
 //256-Bit PRNG
 #include "random_simd.h"
 
+//Statistical Tests
+#include "random_stats.h"
+
 #endif
@@ -6,18 +6,27 @@
 
 #include "random_simd.h"
 #include "random_utils.h"
+#include "bitarray.h"
+#include "instrument.h"
 
 #include <assert.h>
+#include <math.h>
+#include <string.h>
 
 //static prototypes
 static __m256i simd_rng_next_partial(simd_random_t * const rng);
+static int simd_rng_bern_step(simd_random_t * const rng, const __m256 prob);
+static void simd_csa(__m256i *h, __m256i *l, const __m256i a, const __m256i b, const __m256i c);
+static void simd_vndb_block(const __m256i x, uint64_t *bits, uint64_t *count);
+static uint64_t simd_vndb_last(const uint64_t *w, uint64_t m, uint64_t *bits);
 
 /*******************************************************************************
 This it the initialization function for the AVX2 API. ALmost the same as 64-Bit
 but 4 seed parameters make the initialization of each PCG stream easier. It also
 allows for easier debugging as we can initialize a non-SIMD PCG32i and follow
-each "thread" individually. See the unit tests for an example. Since RDRAND 
-needs 10 retries, the 80 total attempts are split in 10-try blocks with goto.
+each "thread" individually. See the unit tests for an example. With any zero
+seed all eight words come from the seeding chain in one batch, which is health
+tested as in rng_init.
 Like a single-stream PCG, the increment parameter must be odd for all streams.
 The upper 32 bits of each 64 bit block are cleared in the state and increment
 vectors as a safety measure. In the generator we don't want to accidentally
@@ -41,6 +50,9 @@ simd_random_t simd_rng_init
     uint64_t LH;
     uint64_t HL;
     uint64_t HH;
+    uint64_t words[8];
+    
+    SIMD_INSTRUMENT_RESET(&simd_rng);
     
     if (seed_1 != 0 && seed_2 != 0 && seed_3 != 0 && seed_4 != 0)
     {
@@ -72,39 +84,16 @@ simd_random_t simd_rng_init
     }
     else
     {
-        if (rdrand(&LL) && rdrand(&LH) && rdrand(&HL) && rdrand(&HH))
-        {
-            simd_rng.state = _mm256_set_epi64x
-            (
-                (int64_t) LL,
-                (int64_t) LH,
-                (int64_t) HL,
-                (int64_t) HH                          
-            );
-            
-            goto first_pass_success;
-        }
-        goto fail;
-        
-        first_pass_success:
-        
-        if (rdrand(&LL) && rdrand(&LH) && rdrand(&HL) && rdrand(&HH))
+        if (rng_seed_words(words, 8))
         {
-            simd_rng.increment = _mm256_set_epi64x
-            (
-                (int64_t) LL,
-                (int64_t) LH,
-                (int64_t) HL,
-                (int64_t) HH  
-            );
-            
+            simd_rng.state = _mm256_loadu_si256((__m256i *) words);
+            simd_rng.increment = _mm256_loadu_si256((__m256i *) (words + 4));
             goto success;
         }
         
-        fail:
-            simd_rng.state = _mm256_setzero_si256();
-            simd_rng.increment = _mm256_setzero_si256();
-            goto terminate;
+        simd_rng.state = _mm256_setzero_si256();
+        simd_rng.increment = _mm256_setzero_si256();
+        goto terminate;
     }
     
     success:
@@ -116,6 +105,56 @@ simd_random_t simd_rng_init
         return simd_rng;
 }
 
+/*******************************************************************************
+The same SplitMix64 sequence as rng_init_many, where each generator takes four
+words for its state and the next four for its increment, cut to 32 bits.
+*/
+
+bool simd_rng_init_many
+(
+    const uint64_t seed, 
+    simd_random_t * const rng, 
+    const size_t count
+)
+{
+    assert(rng != NULL && "generator is null");
+    
+    const uint64_t gamma = 0x9E3779B97F4A7C15ULL;
+    const __m256i step = _mm256_set1_epi64x((int64_t) (4 * gamma));
+    const __m256i mask = _mm256_set1_epi64x((int64_t) 0xFFFFFFFFU);
+    const __m256i odd = _mm256_set1_epi64x((int64_t) 0x1U);
+    uint64_t x = rng_hash(seed);
+    __m256i counter;
+    
+    if (seed == 0 && !rng_seed_words(&x, 1))
+    {
+        memset(rng, 0, count * sizeof(simd_random_t));
+        return false;
+    }
+    
+    counter = _mm256_setr_epi64x
+    (
+        (int64_t) (x + gamma), 
+        (int64_t) (x + 2 * gamma), 
+        (int64_t) (x + 3 * gamma), 
+        (int64_t) (x + 4 * gamma)
+    );
+    
+    for (size_t i = 0; i < count; i++)
+    {
+        rng[i].state = _mm256_and_si256(simd_rng_hash(counter), mask);
+        counter = _mm256_add_epi64(counter, step);
+        
+        rng[i].increment = _mm256_and_si256(simd_rng_hash(counter), mask);
+        rng[i].increment = _mm256_or_si256(rng[i].increment, odd);
+        counter = _mm256_add_epi64(counter, step);
+        
+        SIMD_INSTRUMENT_RESET(rng + i);
+    }
+    
+    return true;
+}
+
 /*******************************************************************************
 This function is a decorator. PCG32i limited to AX2 instructions can only fill
 128 bits per vector. This function runs each stream twice so that in total we
@@ -143,6 +182,509 @@ __m256i simd_rng_next
     return output;
 }
 
+/*******************************************************************************
+AVX2 version of the rng_bias virtual machine, see random_sisd.c for details.
+*/
+
+__m256i simd_rng_bias
+(
+    simd_random_t * const rng, 
+    const uint64_t n, 
+    const int m
+)
+{
+    assert(rng != NULL && "generator is null");
+    assert(n != 0 && "probability is 0");
+    assert(m > 0 && m <= 64 && "invalid base 2 exponent");
+    
+    SIMD_INSTRUMENT_BEGIN(rng);
+    
+    __m256i accumulator = _mm256_setzero_si256();
+    
+    for (int pc = __builtin_ctzll(n); pc < m; pc++)
+    {
+        switch ((n >> pc) & 1)
+        {
+            case 0:
+                accumulator = _mm256_and_si256(accumulator, simd_rng_next(rng));
+                break;
+                
+            case 1:
+                accumulator = _mm256_or_si256(accumulator, simd_rng_next(rng));
+                break;
+        }
+    }
+    
+    SIMD_INSTRUMENT_END(API_SIMD_RNG_BIAS, rng);
+    
+    return accumulator;
+}
+
+/*******************************************************************************
+AVX2 version of rng_bias_lanes. Each plane selects, per bit, whether the next
+generator vector is OR'ed or AND'ed into the accumulator, so 256 lanes with 256
+different probabilities cost the same m generator calls as a single rng_bias.
+*/
+
+__m256i simd_rng_bias_lanes
+(
+    simd_random_t * const rng,
+    const __m256i * const planes,
+    const int m
+)
+{
+    assert(rng != NULL && "generator is null");
+    assert(planes != NULL && "planes are null");
+    assert(m > 0 && m <= 64 && "invalid base 2 exponent");
+    
+    SIMD_INSTRUMENT_BEGIN(rng);
+    
+    __m256i accumulator = _mm256_setzero_si256();
+    __m256i x;
+    int pc = 0;
+    
+    while (pc < m && _mm256_testz_si256(planes[pc], planes[pc])) pc++;
+    
+    for (; pc < m; pc++)
+    {
+        x = simd_rng_next(rng);
+        
+        accumulator = _mm256_or_si256
+        (
+            _mm256_and_si256(accumulator, x),
+            _mm256_and_si256(planes[pc], _mm256_or_si256(accumulator, x))
+        );
+    }
+    
+    SIMD_INSTRUMENT_END(API_SIMD_RNG_BIAS_LANES, rng);
+    
+    return accumulator;
+}
+
+/*******************************************************************************
+Binomial sampling on 256 trials per simd_rng_bias call. Rather than a popcount
+per vector, blocks of 16 vectors go through the Harley-Seal carry-save adder
+network from Mula, Kurz and Lemire, "Faster Population Counts Using AVX2
+Instructions" (2016), so only one vector popcount is needed per 4096 trials.
+The ones/twos/fours/eights accumulators are flushed with their weights at the
+end, leftover whole vectors are counted directly, and the final partial vector
+keeps only its lowest k bits, just as rng_bino shifts its final word.
+*/
+
+uint64_t simd_rng_bino
+(
+    simd_random_t * const rng, 
+    uint64_t k, 
+    const uint64_t n, 
+    const int m
+)
+{
+    assert(rng != NULL && "generator is null");
+    assert(n != 0 && "probability is 0");
+    assert(m > 0 && m <= 64 && "invalid base 2 exponent");
+    assert(k != 0 && "no trials");
+    
+    SIMD_INSTRUMENT_BEGIN(rng);
+    
+    __m256i total = _mm256_setzero_si256();
+    __m256i ones = _mm256_setzero_si256();
+    __m256i twos = _mm256_setzero_si256();
+    __m256i fours = _mm256_setzero_si256();
+    __m256i eights = _mm256_setzero_si256();
+    __m256i sixteens;
+    __m256i twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+    __m256i x, y;
+    
+    for (; k >= 4096; k -= 4096)
+    {
+        x = simd_rng_bias(rng, n, m); y = simd_rng_bias(rng, n, m);
+        simd_csa(&twos_a, &ones, ones, x, y);
+        x = simd_rng_bias(rng, n, m); y = simd_rng_bias(rng, n, m);
+        simd_csa(&twos_b, &ones, ones, x, y);
+        simd_csa(&fours_a, &twos, twos, twos_a, twos_b);
+        x = simd_rng_bias(rng, n, m); y = simd_rng_bias(rng, n, m);
+        simd_csa(&twos_a, &ones, ones, x, y);
+        x = simd_rng_bias(rng, n, m); y = simd_rng_bias(rng, n, m);
+        simd_csa(&twos_b, &ones, ones, x, y);
+        simd_csa(&fours_b, &twos, twos, twos_a, twos_b);
+        simd_csa(&eights_a, &fours, fours, fours_a, fours_b);
+        x = simd_rng_bias(rng, n, m); y = simd_rng_bias(rng, n, m);
+        simd_csa(&twos_a, &ones, ones, x, y);
+        x = simd_rng_bias(rng, n, m); y = simd_rng_bias(rng, n, m);
+        simd_csa(&twos_b, &ones, ones, x, y);
+        simd_csa(&fours_a, &twos, twos, twos_a, twos_b);
+        x = simd_rng_bias(rng, n, m); y = simd_rng_bias(rng, n, m);
+        simd_csa(&twos_a, &ones, ones, x, y);
+        x = simd_rng_bias(rng, n, m); y = simd_rng_bias(rng, n, m);
+        simd_csa(&twos_b, &ones, ones, x, y);
+        simd_csa(&fours_b, &twos, twos, twos_a, twos_b);
+        simd_csa(&eights_b, &fours, fours, fours_a, fours_b);
+        simd_csa(&sixteens, &eights, eights, eights_a, eights_b);
+        
+        total = _mm256_add_epi64(total, u64_bitarray_popcount256(sixteens));
+    }
+    
+    total = _mm256_slli_epi64(total, 4);
+    x = _mm256_slli_epi64(u64_bitarray_popcount256(eights), 3);
+    total = _mm256_add_epi64(total, x);
+    x = _mm256_slli_epi64(u64_bitarray_popcount256(fours), 2);
+    total = _mm256_add_epi64(total, x);
+    x = _mm256_slli_epi64(u64_bitarray_popcount256(twos), 1);
+    total = _mm256_add_epi64(total, x);
+    total = _mm256_add_epi64(total, u64_bitarray_popcount256(ones));
+    
+    for (; k >= 256; k -= 256)
+    {
+        x = u64_bitarray_popcount256(simd_rng_bias(rng, n, m));
+        total = _mm256_add_epi64(total, x);
+    }
+    
+    if (k != 0)
+    {
+        uint64_t mask[4];
+        
+        for (uint64_t i = 0; i < 4; i++)
+        {
+            if (k >= 64 * (i + 1)) mask[i] = ~0ULL;
+            else if (k > 64 * i) mask[i] = ~0ULL >> (64 * (i + 1) - k);
+            else mask[i] = 0;
+        }
+        
+        x = _mm256_and_si256
+        (
+            simd_rng_bias(rng, n, m), 
+            _mm256_loadu_si256((const __m256i *) mask)
+        );
+        
+        total = _mm256_add_epi64(total, u64_bitarray_popcount256(x));
+    }
+    
+    SIMD_INSTRUMENT_END(API_SIMD_RNG_BINO, rng);
+    
+    return (uint64_t) _mm256_extract_epi64(total, 0) 
+         + (uint64_t) _mm256_extract_epi64(total, 1)
+         + (uint64_t) _mm256_extract_epi64(total, 2)
+         + (uint64_t) _mm256_extract_epi64(total, 3);
+}
+
+/*******************************************************************************
+Carry-save adder, the bitwise sum a + b + c is 2h + l.
+*/
+
+static void simd_csa
+(
+    __m256i *h, 
+    __m256i *l, 
+    const __m256i a, 
+    const __m256i b, 
+    const __m256i c
+)
+{
+    const __m256i u = _mm256_xor_si256(a, b);
+    
+    *h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+    *l = _mm256_xor_si256(u, c);
+}
+
+/*******************************************************************************
+Bernoulli trials against an array of float probabilities. Each generator call
+yields eight 32-bit lanes, the upper 24 bits of which are an exact uniform float
+on [0, 1). One ordered compare and a movemask then pack eight trials into the
+output, eight calls fill a 64-bit word which is stored whole. The last partial
+group of probabilities is read with a masked load so we never touch p[n].
+*/
+
+void simd_rng_bern
+(
+    simd_random_t * const rng,
+    const float * const p,
+    const size_t n,
+    uint64_t * const dest
+)
+{
+    assert(rng != NULL && "generator is null");
+    assert(p != NULL && "probabilities are null");
+    assert(dest != NULL && "null dest");
+    
+    SIMD_INSTRUMENT_BEGIN(rng);
+    
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    
+    uint64_t word;
+    size_t i = 0;
+    
+    for (; i + 64 <= n; i += 64)
+    {
+        word = 0;
+        
+        for (size_t j = 0; j < 64; j += 8)
+        {
+            word |= (uint64_t) simd_rng_bern_step(rng, _mm256_loadu_ps(p + i + j)) << j;
+        }
+        
+        dest[i / 64] = word;
+    }
+    
+    if (i < n)
+    {
+        word = 0;
+        
+        for (size_t j = 0; i + j < n; j += 8)
+        {
+            __m256i mask = _mm256_cmpgt_epi32
+            (
+                _mm256_set1_epi32((int) (n - i - j)), 
+                lanes
+            );
+            
+            int bits = simd_rng_bern_step(rng, _mm256_maskload_ps(p + i + j, mask));
+            bits &= _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+            
+            word |= (uint64_t) bits << j;
+        }
+        
+        dest[i / 64] = word;
+    }
+    
+    SIMD_INSTRUMENT_END(API_SIMD_RNG_BERN, rng);
+}
+
+/*******************************************************************************
+Eight bernoulli trials for simd_rng_bern. The shift right by 8 leaves a 24-bit
+integer which converts to float without rounding, and the scale is a power of 2.
+*/
+
+static int simd_rng_bern_step
+(
+    simd_random_t * const rng, 
+    const __m256 prob
+)
+{
+    const __m256 scale = _mm256_set1_ps(5.9604644775390625E-8f);
+    
+    __m256i x = _mm256_srli_epi32(simd_rng_next(rng), 8);
+    __m256 u = _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale);
+    
+    return _mm256_movemask_ps(_mm256_cmp_ps(u, prob, _CMP_LT_OQ));
+}
+
+/*******************************************************************************
+AVX2 Von Neumann Debiaser, same contract as rng_vndb. Each 256-bit block is
+reduced by simd_vndb_block to two compacted outputs of at most 64 bits, one per
+128 source bits, which are appended through a 64-bit accumulator so that every
+destination word is stored exactly once. The final partial block is copied into
+a zeroed buffer, zero pairs are concordant and produce nothing. The half block
+that would overfill dest falls back to a bit-pair walk up to the mth bit.
+*/
+
+stream_t simd_rng_vndb
+(
+    const uint64_t * restrict src, 
+    uint64_t * restrict dest, 
+    const uint64_t n, 
+    const uint64_t m
+)
+{
+    assert(src != NULL && "null source");
+    assert(dest != NULL && "null dest");
+    assert(n != 0 && "nothing to read");
+    assert(m != 0 && "nowhere to write");
+    assert(n % 2 == 0 && "cannot process odd-length bitstream");
+    
+    uint64_t read_pos = 0;
+    uint64_t write_pos = 0;
+    uint64_t used = 0;
+    uint64_t accumulator = 0;
+    uint64_t fill = 0;
+    uint64_t *next = dest;
+    uint64_t bits[2];
+    uint64_t count[2];
+    uint64_t tail[4];
+    __m256i x;
+    
+    stream_t info = {.used = 0, .filled = 0};
+    
+    while (read_pos < n && write_pos < m)
+    {
+        if (n - read_pos >= 256)
+        {
+            x = _mm256_loadu_si256((const __m256i *) (src + read_pos / 64));
+        }
+        else
+        {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, src + read_pos / 64, (n - read_pos + 63) / 64 * 8);
+            if (n % 64) tail[(n - read_pos) / 64] &= (1ULL << (n % 64)) - 1;
+            x = _mm256_loadu_si256((const __m256i *) tail);
+        }
+        
+        simd_vndb_block(x, bits, count);
+        
+        for (size_t i = 0; i < 2 && write_pos < m; i++)
+        {
+            if (count[i] >= m - write_pos)
+            {
+                _mm256_storeu_si256((__m256i *) tail, x);
+                used = read_pos + 128 * i;
+                used += simd_vndb_last(tail + 2 * i, m - write_pos, &bits[i]);
+                count[i] = m - write_pos;
+            }
+            
+            accumulator |= bits[i] << fill;
+            fill += count[i];
+            write_pos += count[i];
+            
+            if (fill >= 64)
+            {
+                *next++ = accumulator;
+                fill -= 64;
+                accumulator = fill ? bits[i] >> (count[i] - fill) : 0;
+            }
+        }
+        
+        read_pos += 256;
+    }
+    
+    if (fill != 0) *next++ = accumulator;
+    
+    memset(next, 0, (size_t) (dest + (m - 1) / 64 + 1 - next) * sizeof(uint64_t));
+    
+    info.used = write_pos == m ? used : n;
+    info.filled = write_pos;
+    return info;
+}
+
+/*******************************************************************************
+Debias the 128 bit-pairs of a 256-bit block with shuffle lookup tables, giving
+the compacted output of each 128-bit half in bits and its length in count. Each
+nibble holds two pairs, so a 16-entry table gives its output bits and another
+its output length. The two nibbles of a byte are merged by a third table that
+shifts the high nibble's output past the low nibble's. From there the halves
+are merged at 16, 32, 64 and 128 bits, the 16-bit shift being a multiply by a 
+power of two since AVX2 has no variable shift on 16-bit lanes.
+*/
+
+static void simd_vndb_block
+(
+    const __m256i x, 
+    uint64_t *bits, 
+    uint64_t *count
+)
+{
+    const __m256i nibble_bits = _mm256_setr_epi8
+    (
+        0, 1, 0, 0, 1, 3, 2, 1, 0, 1, 0, 0, 0, 1, 0, 0,
+        0, 1, 0, 0, 1, 3, 2, 1, 0, 1, 0, 0, 0, 1, 0, 0
+    );
+    
+    const __m256i nibble_count = _mm256_setr_epi8
+    (
+        0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0,
+        0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0
+    );
+    
+    const __m256i nibble_shift = _mm256_setr_epi8
+    (
+        0, 1, 2, 3, 0, 2, 4, 6, 0, 4, 8, 12, 0, 0, 0, 0,
+        0, 1, 2, 3, 0, 2, 4, 6, 0, 4, 8, 12, 0, 0, 0, 0
+    );
+    
+    const __m256i power = _mm256_setr_epi8
+    (
+        1, 2, 4, 8, 16, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 2, 4, 8, 16, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+    );
+    
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    const __m256i low_byte = _mm256_set1_epi16(0x00FF);
+    const __m256i low_short = _mm256_set1_epi32(0x0000FFFF);
+    const __m256i low_int = _mm256_set1_epi64x(0xFFFFFFFFLL);
+    
+    __m256i lo = _mm256_and_si256(x, low_nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), low_nibble);
+    __m256i lo_count = _mm256_shuffle_epi8(nibble_count, lo);
+    __m256i val;
+    __m256i len;
+    __m256i shift;
+    
+    //bytes
+    val = _mm256_shuffle_epi8(nibble_bits, hi);
+    val = _mm256_or_si256(val, _mm256_slli_epi16(lo_count, 2));
+    val = _mm256_shuffle_epi8(nibble_shift, val);
+    val = _mm256_or_si256(val, _mm256_shuffle_epi8(nibble_bits, lo));
+    len = _mm256_add_epi8(lo_count, _mm256_shuffle_epi8(nibble_count, hi));
+    
+    //shorts
+    shift = _mm256_and_si256(_mm256_shuffle_epi8(power, len), low_byte);
+    val = _mm256_or_si256
+    (
+        _mm256_and_si256(val, low_byte),
+        _mm256_mullo_epi16(_mm256_srli_epi16(val, 8), shift)
+    );
+    len = _mm256_add_epi16(_mm256_and_si256(len, low_byte), _mm256_srli_epi16(len, 8));
+    
+    //ints
+    shift = _mm256_and_si256(len, low_short);
+    val = _mm256_or_si256
+    (
+        _mm256_and_si256(val, low_short),
+        _mm256_sllv_epi32(_mm256_srli_epi32(val, 16), shift)
+    );
+    len = _mm256_add_epi32(shift, _mm256_srli_epi32(len, 16));
+    
+    //longs
+    shift = _mm256_and_si256(len, low_int);
+    val = _mm256_or_si256
+    (
+        _mm256_and_si256(val, low_int),
+        _mm256_sllv_epi64(_mm256_srli_epi64(val, 32), shift)
+    );
+    len = _mm256_add_epi64(shift, _mm256_srli_epi64(len, 32));
+    
+    //halves
+    val = _mm256_or_si256(val, _mm256_sllv_epi64(_mm256_srli_si256(val, 8), len));
+    len = _mm256_add_epi64(len, _mm256_srli_si256(len, 8));
+    
+    bits[0] = (uint64_t) _mm256_extract_epi64(val, 0);
+    bits[1] = (uint64_t) _mm256_extract_epi64(val, 2);
+    count[0] = (uint64_t) _mm256_extract_epi64(len, 0);
+    count[1] = (uint64_t) _mm256_extract_epi64(len, 2);
+}
+
+/*******************************************************************************
+Bit-pair walk over the two words that fill the destination, m is the remaining
+room and bits receives the first m output bits. Returns the source bits used.
+*/
+
+static uint64_t simd_vndb_last
+(
+    const uint64_t *w, 
+    uint64_t m, 
+    uint64_t *bits
+)
+{
+    uint64_t pos = 0;
+    uint64_t k = 0;
+    
+    *bits = 0;
+    
+    for (; k < m; pos += 2)
+    {
+        switch ((w[pos / 64] >> (pos % 64)) & 3)
+        {
+            case 1:
+                *bits |= 1ULL << k;
+                k++;
+                break;
+            case 2:
+                k++;
+                break;
+        }
+    }
+    
+    return pos;
+}
+
 /*******************************************************************************
 The following code is originally Copyright 2014 Melissa O'Neill pcg_random.org,
 Licensed under the Apache License, Version 2.0. 
@@ -174,6 +716,8 @@ static __m256i simd_rng_next_partial
     __m256i x  = rng->state;
     __m256i fx = _mm256_setzero_si256();
     
+    SIMD_INSTRUMENT_DRAW(rng);
+    
     fx = _mm256_add_epi32(_mm256_srli_epi32(x, 28), _mm256_set1_epi32(4LL));
     fx = _mm256_srlv_epi32(x, fx);
     fx = _mm256_xor_si256(x, fx);
@@ -188,3 +732,21 @@ static __m256i simd_rng_next_partial
     
     return fx;
 }
+
+#ifdef RNG_INSTRUMENT
+
+/*******************************************************************************
+Every stream takes the same number of steps, so the first one speaks for all.
+*/
+
+double simd_rng_period_used
+(
+    const simd_random_t * const rng
+)
+{
+    assert(rng != NULL && "generator is null");
+    
+    return ldexp((double) (uint64_t) _mm256_extract_epi64(rng->draws, 0), -32);
+}
+
+#endif
@@ -7,7 +7,10 @@
 #ifndef SIMD_RANDOM_H
 #define SIMD_RANDOM_H
 
+#include "random_sisd.h"
+
 #include <stdint.h>
+#include <stddef.h>
 #include <immintrin.h>
 
 /*******************************************************************************
@@ -15,11 +18,15 @@
 * DESC: internal state of the default vectorized PRNG
 * @ state : contains state of 4 streams in lower 32 bits of each 64 bit block
 * @ increment : contain stream identifiers in lower 32 bits of each 64 bit block
+* @ draws : steps taken by each stream, RNG_INSTRUMENT builds only
 *******************************************************************************/
 typedef struct
 {
     __m256i state;
     __m256i increment;
+    #ifdef RNG_INSTRUMENT
+        __m256i draws;
+    #endif
 } simd_random_t;
 
 /*******************************************************************************
@@ -36,6 +43,21 @@ simd_random_t simd_rng_init
     const uint64_t seed_4
 );
 
+/*******************************************************************************
+* NAME: simd_rng_init_many
+* DESC: initialize an array of simd_random_t from consecutive outputs of
+*       SplitMix64, as rng_init_many, eight words per generator
+* OUTP: false if seed = 0 and no seed word could be drawn, the array is zeroed
+* @ seed : set seed = 0 for a single non-deterministic seed word
+* @ rng : array of count generators
+*******************************************************************************/
+bool simd_rng_init_many
+(
+    const uint64_t seed, 
+    simd_random_t * const rng, 
+    const size_t count
+);
+
 /*******************************************************************************
 * NAME: simd_rng_next
 * DESC: generate 256-Bit psuedo random numbers via the default PRNG
@@ -43,4 +65,90 @@ simd_random_t simd_rng_init
 *******************************************************************************/
 __m256i simd_rng_next (simd_random_t * const rng);
 
+#ifdef RNG_INSTRUMENT
+
+/*******************************************************************************
+* NAME: simd_rng_period_used
+* DESC: fraction of the 2^32 period of each stream drawn since initialization,
+*       every simd_rng_next call takes two steps on all four streams
+* OUTP: draws / 2^32, above 1 once the streams have wrapped
+*******************************************************************************/
+double simd_rng_period_used(const simd_random_t * const rng);
+
+#endif
+
+/*******************************************************************************
+* NAME: simd_rng_bias
+* DESC: simultaneous generation of 256 iid bernoulli trials
+* OUTP: 256-bit vector where each bit has probability p = n/2^m of success
+* NOTE: m limits the total calls to simd_rng_next, so smaller m is faster code
+* @ n : nonzero numerator of probability, strictly less than 2^m
+* @ m : nonzero base 2 exponent less than or equal to 64
+*******************************************************************************/
+__m256i simd_rng_bias(simd_random_t * const rng, const uint64_t n, const int m);
+
+/*******************************************************************************
+* NAME: simd_rng_bias_lanes
+* DESC: 256 bernoulli trials where each bit position has its own probability
+* OUTP: 256-bit vector where bit j has probability p_j = n_j/2^m of success
+* NOTE: a lane with a zero numerator is never set
+* @ planes : m bit planes, bit j of planes[i] is bit i of numerator n_j
+* @ m : nonzero base 2 exponent less than or equal to 64
+*******************************************************************************/
+__m256i simd_rng_bias_lanes
+(
+    simd_random_t * const rng,
+    const __m256i * const planes,
+    const int m
+);
+
+/*******************************************************************************
+* NAME: simd_rng_bino
+* DESC: sample from a binomial distribution X~(k,p) where p = n/2^m
+* OUTP: number of successful trials
+* @ k : total trials
+* @ n : nonzero numerator of probability, strictly less than 2^m
+* @ m : nonzero base 2 exponent less than or equal to 64
+*******************************************************************************/
+uint64_t simd_rng_bino
+(
+    simd_random_t * const rng, 
+    uint64_t k, 
+    const uint64_t n, 
+    const int m
+);
+
+/*******************************************************************************
+* NAME: simd_rng_bern
+* DESC: one bernoulli trial per element of a float probability array
+* OUTP: dest bit i is set with probability p[i], bits beyond n are cleared
+* NOTE: probabilities have 24 bits of resolution, p <= 0 or NaN is never set
+* @ p : array of n probabilities
+* @ n : total trials
+* @ dest : bit array with space for n bits, rounded up to a 64-bit word
+*******************************************************************************/
+void simd_rng_bern
+(
+    simd_random_t * const rng,
+    const float * const p,
+    const size_t n,
+    uint64_t * const dest
+);
+
+/*******************************************************************************
+* NAME: simd_rng_vndb
+* DESC: AVX2 Von Neumann Debiaser for iid biased bits with zero autocorrelation
+* OUTP: dest is filled with stream_t.filled bits, which used stream_t.used bits
+* NOTE: same contract and output as rng_vndb, 256 source bits per step
+* @ src : binary bit stream of length n bits
+* @ dest : binary bit stream of length m bits
+*******************************************************************************/
+stream_t simd_rng_vndb
+(
+    const uint64_t * restrict src, 
+    uint64_t * restrict dest, 
+    const uint64_t n, 
+    const uint64_t m
+);
+
 #endif
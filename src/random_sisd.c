@@ -7,147 +7,1153 @@
 #include "random_sisd.h"
 #include "random_utils.h"
 #include "bitarray.h"
+#include "instrument.h"
 
 #include <string.h>
+#include <stdlib.h>
 #include <assert.h>
-#include <limits.h>
+#include <math.h>
+#include <immintrin.h>
+
+//static prototypes
+static uint64_t rng_index(random_t * const rng, const uint64_t max);
+static uint64_t rng_markov_run(random_t * const rng, markov_t * const chain);
+static inline uint64_t bits_pext(uint64_t x, uint64_t mask);
+static inline uint64_t bits_select(uint64_t x, uint64_t k);
+static inline void bits_append(uint64_t *dest, uint64_t pos, uint64_t x, uint64_t k);
+static uint64_t cycc_count
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const uint64_t k, 
+    const uint64_t lo, 
+    const uint64_t hi
+);
+static uint64_t cycc_popcount
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const uint64_t lo, 
+    const uint64_t hi
+);
+static double cycc_ratio(const uint64_t n, const uint64_t x1, const uint64_t x2);
+static inline void ring_append(vndb_stream_t * const ctx, uint64_t x, uint64_t k);
+static inline uint64_t vndb_word(uint64_t w, uint64_t n, uint64_t m, uint64_t *x, uint64_t *k);
+static void peres_pass
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const int depth, 
+    uint64_t *dest, 
+    const uint64_t m, 
+    uint64_t *filled
+);
+
+/*******************************************************************************
+Since this is a non-crypto statistics library, I use rdrand instead of rdseed
+because it is A) faster since it doesn't require a pass through an extrator for
+full entropy and B) less or almost zero-prone to underflow. David Johnston
+explains this well in 13.4 of "Random Number Generators". Per Intel docs, rdrand
+is retried up to ten times per variable, hence the else clause goto fuckery. The
+words come from the seeding chain, see rng_seed_chain, which starts at the
+entropy pool and rdrand. The chain runs the SP 800-90B health tests on them and
+falls back past a stuck source, so the state is only zeroed if every source in
+the chain fails or is rejected. For PCG, ensure the increment is odd.
+*/
+
+random_t rng_init
+(
+    const uint64_t seed
+)
+{
+    random_t rng;
+    uint64_t words[2];
+    
+    INSTRUMENT_RESET(&rng);
+    
+    if (seed != 0) 
+    {
+        rng.state = rng_hash(seed);
+        rng.increment = rng_hash(rng_hash(seed));
+    }
+    else
+    {
+        if (rng_seed_words(words, 2))
+        {
+            rng.state = words[0];
+            rng.increment = words[1];
+            goto success;
+        }
+
+        rng.state = 0;
+        rng.increment = 0;
+        goto terminate;
+    }
+    
+    success:
+        rng.increment |= 1;
+    
+    terminate:
+        return rng;
+}
+
+/*******************************************************************************
+SplitMix64 is a counter stepped by the golden ratio and passed through the same
+mixer as rng_hash. The mixer is a bijection, so as long as fewer than 2^63 words
+are drawn every state is distinct and so is every increment before it is made
+odd. Each 256-bit hash is two random_t, which are stored as they come out. The
+instrumented random_t is larger, so that build fills every generator one at a
+time.
+*/
+
+bool rng_init_many
+(
+    const uint64_t seed, 
+    random_t * const rng, 
+    const size_t count
+)
+{
+    assert(rng != NULL && "generator is null");
+    
+    const uint64_t gamma = 0x9E3779B97F4A7C15ULL;
+    const __m256i step = _mm256_set1_epi64x((int64_t) (4 * gamma));
+    const __m256i odd = _mm256_setr_epi64x(0, 1, 0, 1);
+    uint64_t x = rng_hash(seed);
+    __m256i counter;
+    size_t i = 0;
+    
+    if (seed == 0 && !rng_seed_words(&x, 1))
+    {
+        memset(rng, 0, count * sizeof(random_t));
+        return false;
+    }
+    
+    counter = _mm256_setr_epi64x
+    (
+        (int64_t) (x + gamma), 
+        (int64_t) (x + 2 * gamma), 
+        (int64_t) (x + 3 * gamma), 
+        (int64_t) (x + 4 * gamma)
+    );
+    
+    for (; sizeof(random_t) == 2 * sizeof(uint64_t) && i + 2 <= count; i += 2)
+    {
+        _mm256_storeu_si256
+        (
+            (__m256i *) (rng + i), 
+            _mm256_or_si256(simd_rng_hash(counter), odd)
+        );
+        
+        counter = _mm256_add_epi64(counter, step);
+    }
+    
+    for (; i < count; i++)
+    {
+        rng[i].state = rng_hash(x + (2 * i + 1) * gamma);
+        rng[i].increment = rng_hash(x + (2 * i + 2) * gamma) | 1;
+        INSTRUMENT_RESET(rng + i);
+    }
+    
+    return true;
+}
+
+/*******************************************************************************
+This function uses a virtual machine to interpret a portion of the bit pattern
+in the numerator parameter as executable bitcode. I wrote a short essay at url
+https://stackoverflow.com/questions/35795110/ (username Ollie) to demonstrate
+the concepts using 256 bits of resolution.
+*/
+
+uint64_t rng_bias 
+(
+    random_t * const rng, 
+    const uint64_t n, 
+    const int m
+)
+{
+    assert(rng != NULL && "generator is null");
+    assert(n != 0 && "probability is 0");
+    assert(m > 0 && m <= 64 && "invalid base 2 exponent");
+    
+    INSTRUMENT_BEGIN(rng);
+    
+    uint64_t accumulator = 0;
+    
+    for (int pc = __builtin_ctzll(n); pc < m; pc++)
+    {
+        switch ((n >> pc) & 1)
+        {
+            case 0:
+                accumulator &= rng_next(rng);
+                break;
+                
+            case 1:
+                accumulator |= rng_next(rng);
+                break;
+        }
+    }
+    
+    INSTRUMENT_END(API_RNG_BIAS, rng);
+    
+    return accumulator;
+}
+
+/*******************************************************************************
+Bit-sliced version of the rng_bias virtual machine. Every lane runs the same
+program counter over the same generator words, but the instruction at each step
+comes from the lane's own numerator bit. The switch in rng_bias becomes a select
+between the AND and the OR accumulators. Leading all-zero planes are skipped for
+the same reason the trailing zeros of n are skipped in rng_bias; the accumulator
+is still zero on every lane at that point.
+*/
+
+uint64_t rng_bias_lanes
+(
+    random_t * const rng,
+    const uint64_t * const planes,
+    const int m
+)
+{
+    assert(rng != NULL && "generator is null");
+    assert(planes != NULL && "planes are null");
+    assert(m > 0 && m <= 64 && "invalid base 2 exponent");
+    
+    INSTRUMENT_BEGIN(rng);
+    
+    uint64_t accumulator = 0;
+    uint64_t x;
+    int pc = 0;
+    
+    while (pc < m && planes[pc] == 0) pc++;
+    
+    for (; pc < m; pc++)
+    {
+        x = rng_next(rng);
+        accumulator = (accumulator & x) | (planes[pc] & (accumulator | x));
+    }
+    
+    INSTRUMENT_END(API_RNG_BIAS_LANES, rng);
+    
+    return accumulator;
+}
+
+/*******************************************************************************
+Exact-weight bit mask. When k > n/2 we build the mask of the n - k clear bits
+instead and complement it, so the working weight j never exceeds n/2. Sparse
+masks use Robert Floyd's subset sampling with the bit array itself as the set,
+exactly j index draws and no scratch memory. Denser masks fill the words with
+rng_bias at p ~= j/n on 8 bits of resolution, then repair the popcount by
+clearing random set bits or setting random clear bits until it equals j. The
+fill is iid and every repair step picks uniformly among the candidate bits, so
+the process is exchangeable and the final mask is uniform over all j-subsets.
+This takes the place of a partial Fisher-Yates shuffle, which would require an
+index buffer of n elements.
+*/
+
+void rng_kmask
+(
+    random_t * const rng, 
+    uint64_t * const dest, 
+    const uint64_t n, 
+    const uint64_t k
+)
+{
+    assert(rng != NULL && "generator is null");
+    assert(dest != NULL && "null dest");
+    assert(n != 0 && "no bits");
+    assert(k <= n && "weight exceeds length");
+    
+    INSTRUMENT_BEGIN(rng);
+    
+    u64_bitarray(dest);
+    
+    const uint64_t words = (n - 1) / 64 + 1;
+    const uint64_t j = k > n / 2 ? n - k : k;
+    
+    uint64_t count = 0;
+    uint64_t r;
+    
+    if (j * 64 < n)
+    {
+        memset(dest, 0, words * sizeof(uint64_t));
+        
+        for (uint64_t t = n - j; t < n; t++)
+        {
+            r = rng_index(rng, t);
+            
+            if (u64_bitarray_test(dest, r)) u64_bitarray_set(dest, t);
+            else u64_bitarray_set(dest, r);
+        }
+    }
+    else
+    {
+        uint64_t numerator = (256 * j + n / 2) / n;
+        
+        for (uint64_t i = 0; i < words; i++)
+        {
+            dest[i] = rng_bias(rng, numerator, 8);
+        }
+        
+        if (n % 64) dest[words - 1] &= (1ULL << (n % 64)) - 1;
+        
+        for (uint64_t i = 0; i < words; i++)
+        {
+            count += (uint64_t) __builtin_popcountll(dest[i]);
+        }
+        
+        while (count > j)
+        {
+            r = rng_index(rng, n - 1);
+            
+            if (u64_bitarray_test(dest, r))
+            {
+                u64_bitarray_clear(dest, r);
+                count--;
+            }
+        }
+        
+        while (count < j)
+        {
+            r = rng_index(rng, n - 1);
+            
+            if (!u64_bitarray_test(dest, r))
+            {
+                u64_bitarray_set(dest, r);
+                count++;
+            }
+        }
+    }
+    
+    if (j != k)
+    {
+        for (uint64_t i = 0; i < words; i++)
+        {
+            dest[i] = ~dest[i];
+        }
+        
+        if (n % 64) dest[words - 1] &= (1ULL << (n % 64)) - 1;
+    }
+    
+    INSTRUMENT_END(API_RNG_KMASK, rng);
+}
+
+/*******************************************************************************
+Uniform index on [0, max] through rng_rand, which requires max > 0.
+*/
+
+static uint64_t rng_index
+(
+    random_t * const rng, 
+    const uint64_t max
+)
+{
+    return max == 0 ? 0 : rng_rand(rng, 0, max);
+}
+
+/*******************************************************************************
+A two-state chain is a sequence of alternating runs whose lengths are geometric
+in the probability of leaving the current state, so the stream is generated one
+run at a time and runs are written as whole-word masks. Run lengths come from
+one of two samplers, picked per state. Short runs count failures in a cached
+rng_bias word with ctz, every cached trial is used exactly once. Long runs would
+need many rng_bias words per run, so when a run costs more than about 4 calls
+to rng_next that way we invert a single uniform double instead.
+*/
+
+markov_t rng_markov_init
+(
+    const int state,
+    const uint64_t n01,
+    const int m01,
+    const uint64_t n10,
+    const int m10
+)
+{
+    assert((state == 0 || state == 1) && "invalid state");
+    assert(n01 != 0 && n10 != 0 && "probability is 0");
+    assert(m01 > 0 && m01 <= 64 && "invalid base 2 exponent");
+    assert(m10 > 0 && m10 <= 64 && "invalid base 2 exponent");
+    assert((m01 == 64 || n01 >> m01 == 0) && "probability is not below 1");
+    assert((m10 == 64 || n10 >> m10 == 0) && "probability is not below 1");
+    
+    markov_t chain = 
+    {
+        .n = {n01, n10},
+        .cache = {0, 0},
+        .log_q = {0.0, 0.0},
+        .run = 0,
+        .state = (uint64_t) state,
+        .m = {m01, m10},
+        .avail = {0, 0}
+    };
+    
+    for (int i = 0; i < 2; i++)
+    {
+        double p = ldexp((double) chain.n[i], -chain.m[i]);
+        double calls = chain.m[i] - __builtin_ctzll(chain.n[i]);
+        
+        if (calls / (64.0 * p) > 4.0) chain.log_q[i] = log1p(-p);
+    }
+    
+    return chain;
+}
+
+/*******************************************************************************
+The current run carries over between calls, so a stream split into chunks of
+any length is identical to the stream generated in one call.
+*/
+
+void rng_markov
+(
+    random_t * const rng,
+    markov_t * const chain,
+    uint64_t * const dest,
+    const uint64_t n
+)
+{
+    assert(rng != NULL && "generator is null");
+    assert(chain != NULL && "chain is null");
+    assert(dest != NULL && "null dest");
+    
+    INSTRUMENT_BEGIN(rng);
+    
+    uint64_t word = 0;
+    uint64_t pos = 0;
+    uint64_t written = 0;
+    uint64_t take;
+    uint64_t *next = dest;
+    
+    while (written < n)
+    {
+        if (chain->run == 0) chain->run = rng_markov_run(rng, chain);
+        
+        take = 64 - pos;
+        if (take > n - written) take = n - written;
+        if (take > chain->run) take = chain->run;
+        
+        if (chain->state) word |= (~0ULL >> (64 - take)) << pos;
+        
+        pos += take;
+        written += take;
+        chain->run -= take;
+        
+        if (pos == 64)
+        {
+            *next++ = word;
+            word = 0;
+            pos = 0;
+        }
+        
+        if (chain->run == 0) chain->state ^= 1;
+    }
+    
+    if (pos != 0) *next = word;
+    
+    INSTRUMENT_END(API_RNG_MARKOV, rng);
+}
+
+/*******************************************************************************
+Length of a run in the current state, P(L = l) = (1 - p)^(l - 1) * p. For the
+cache sampler each bit of an rng_bias word is one trial, consumed trials are
+shifted out so the unused ones always sit at the bottom of the word.
+*/
+
+static uint64_t rng_markov_run
+(
+    random_t * const rng, 
+    markov_t * const chain
+)
+{
+    const uint64_t s = chain->state;
+    uint64_t length = 1;
+    double u;
+    double x;
+    int t;
+    
+    if (chain->log_q[s] != 0.0)
+    {
+        u = ldexp((double) ((rng_next(rng) >> 11) + 1), -53);
+        x = floor(log(u) / chain->log_q[s]);
+        
+        return x >= 0x1p63 ? 1ULL << 63 : length + (uint64_t) x;
+    }
+    
+    while (1)
+    {
+        if (chain->avail[s] == 0)
+        {
+            chain->cache[s] = rng_bias(rng, chain->n[s], chain->m[s]);
+            chain->avail[s] = 64;
+        }
+        
+        if (chain->cache[s] == 0)
+        {
+            length += (uint64_t) chain->avail[s];
+            chain->avail[s] = 0;
+            continue;
+        }
+        
+        t = __builtin_ctzll(chain->cache[s]);
+        chain->cache[s] = t == 63 ? 0 : chain->cache[s] >> (t + 1);
+        chain->avail[s] -= t + 1;
+        
+        return length + (uint64_t) t;
+    }
+}
+
+/*******************************************************************************
+Von Neumann Debiaser for biased bits with no autocorrelation. Feed a low entropy
+n-bit bitstream into the debiaser, get a high-entropy at-most-m-bit bitstream.
+It may be that not all source bits are used and/or not all destination bits are
+filled. The source is read as consecutive bit-pairs, but a whole 64-bit word of
+32 pairs is debiased at once by vndb_word and appended to the destination with
+a shift. Destination words are overwritten as they are reached, and the words
+past the last filled bit are zeroed at the end.
+*/
+
+stream_t rng_vndb 
+(
+    const uint64_t * restrict src, 
+    uint64_t * restrict dest, 
+    const uint64_t n, 
+    const uint64_t m
+)
+{  
+    assert(src != NULL && "null source");
+    assert(dest != NULL && "null dest");
+    assert(n != 0 && "nothing to read");
+    assert(m != 0 && "nowhere to write");
+    assert(n % 2 == 0 && "cannot process odd-length bitstream");
+    
+    uint64_t write_pos = 0;
+    uint64_t read_pos = 0;
+    uint64_t bits;
+    uint64_t count;
+    
+    stream_t info = {.used = 0, .filled = 0};
+    
+    while (read_pos < n && write_pos < m)
+    {
+        read_pos += vndb_word
+        (
+            src[read_pos / 64], 
+            n - read_pos, 
+            m - write_pos, 
+            &bits, 
+            &count
+        );
+        
+        bits_append(dest, write_pos, bits, count);
+        write_pos += count;
+    }
+    
+    if (write_pos < m)
+    {
+        uint64_t first = (write_pos + 63) / 64;
+        memset(dest + first, 0, ((m - 1) / 64 + 1 - first) * sizeof(uint64_t));
+    }
+    
+    info.used = read_pos;
+    info.filled = write_pos;
+    return info;
+}
+
+/*******************************************************************************
+The ring buffer belongs to the caller, who consumes it however they like, we
+only track the head. Since output words are overwritten as the head enters
+them, the ring never needs to be cleared.
+*/
+
+vndb_stream_t rng_vndb_stream_init
+(
+    uint64_t * const ring, 
+    const uint64_t size
+)
+{
+    assert(ring != NULL && "null ring");
+    assert(size != 0 && size % 64 == 0 && "invalid ring size");
+    
+    vndb_stream_t ctx =
+    {
+        .ring = ring,
+        .size = size,
+        .head = 0,
+        .total = 0,
+        .pending = 0,
+        .has_pending = 0
+    };
+    
+    return ctx;
+}
+
+/*******************************************************************************
+Chunked version of rng_vndb. A pair that was split at the end of the previous
+chunk is completed with the first source bit, after which the source is read at
+an odd bit offset. u64_bitarray_load funnels two words together for that case,
+so the word-level vndb_word kernel is used either way.
+*/
+
+stream_t rng_vndb_stream
+(
+    vndb_stream_t * const ctx,
+    const uint64_t * const src,
+    const uint64_t n,
+    const uint64_t m
+)
+{
+    assert(ctx != NULL && "null context");
+    assert(src != NULL && "null source");
+    assert(n != 0 && "nothing to read");
+    assert(m != 0 && m <= ctx->size && "invalid output cap");
+    
+    uint64_t read_pos = 0;
+    uint64_t pair;
+    uint64_t bits;
+    uint64_t count;
+    
+    stream_t info = {.used = 0, .filled = 0};
+    
+    if (ctx->has_pending)
+    {
+        pair = ctx->pending | (src[0] & 1) << 1;
+        ctx->has_pending = 0;
+        read_pos = 1;
+        
+        if (pair == 1 || pair == 2)
+        {
+            ring_append(ctx, pair & 1, 1);
+            info.filled = 1;
+        }
+    }
+    
+    while (n - read_pos >= 2 && info.filled < m)
+    {
+        read_pos += vndb_word
+        (
+            u64_bitarray_load(src, read_pos, n), 
+            (n - read_pos) & ~1ULL, 
+            m - info.filled, 
+            &bits, 
+            &count
+        );
+        
+        ring_append(ctx, bits, count);
+        info.filled += count;
+    }
+    
+    if (n - read_pos == 1 && info.filled < m)
+    {
+        ctx->pending = (src[read_pos / 64] >> (read_pos % 64)) & 1;
+        ctx->has_pending = 1;
+        read_pos = n;
+    }
+    
+    ctx->total += info.filled;
+    info.used = read_pos;
+    return info;
+}
+
+/*******************************************************************************
+bits_append for the ring buffer, an append which runs past the end of the ring
+is split in two and its upper part continues at the start.
+*/
+
+static inline void ring_append
+(
+    vndb_stream_t * const ctx, 
+    uint64_t x, 
+    uint64_t k
+)
+{
+    const uint64_t room = ctx->size - ctx->head;
+    
+    if (k > room)
+    {
+        bits_append(ctx->ring, ctx->head, x & (~0ULL >> (64 - room)), room);
+        bits_append(ctx->ring, 0, x >> room, k - room);
+        ctx->head = k - room;
+        return;
+    }
+    
+    bits_append(ctx->ring, ctx->head, x, k);
+    ctx->head += k;
+    
+    if (ctx->head == ctx->size) ctx->head = 0;
+}
+
+/*******************************************************************************
+Yuval Peres, "Iterating Von Neumann's Procedure for Extracting Random Bits",
+The Annals of Statistics 20 (1992). The output is the Von Neumann output of the
+source, followed by the recursive output of the XOR of every pair, followed by
+the recursive output of the common value of every concordant pair. Both derived
+streams are iid when the source is, and at depth d the output rate approaches
+the entropy of the source as d grows. All three streams come from the same
+word-level bit tricks as rng_vndb, so each level costs about one rng_vndb pass.
+*/
+
+stream_t rng_peres
+(
+    const uint64_t * restrict src, 
+    uint64_t * restrict dest, 
+    const uint64_t n, 
+    const uint64_t m,
+    const int depth
+)
+{
+    assert(src != NULL && "null source");
+    assert(dest != NULL && "null dest");
+    assert(n != 0 && "nothing to read");
+    assert(m != 0 && "nowhere to write");
+    assert(n % 2 == 0 && "cannot process odd-length bitstream");
+    assert(depth > 0 && "invalid depth");
+    
+    uint64_t read_pos = 0;
+    uint64_t write_pos = 0;
+    uint64_t bits;
+    uint64_t count;
+    
+    stream_t info = {.used = 0, .filled = 0};
+    
+    while (read_pos < n && write_pos < m)
+    {
+        read_pos += vndb_word(src[read_pos / 64], n - read_pos, m - write_pos, &bits, &count);
+        bits_append(dest, write_pos, bits, count);
+        write_pos += count;
+    }
+    
+    if (write_pos < m)
+    {
+        read_pos = n;
+        peres_pass(src, n, depth - 1, dest, m, &write_pos);
+        
+        uint64_t first = (write_pos + 63) / 64;
+        memset(dest + first, 0, ((m - 1) / 64 + 1 - first) * sizeof(uint64_t));
+    }
+    
+    info.used = read_pos;
+    info.filled = write_pos;
+    return info;
+}
+
+/*******************************************************************************
+Split the n-bit source into its XOR stream and its concordant-value stream and
+feed both through depth more levels of Peres, appending to dest at filled. The
+trailing bit of an odd-length stream has no partner and is dropped. If either
+buffer cannot be allocated the extra levels are skipped and less is output.
+*/
+
+static void peres_pass
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const int depth, 
+    uint64_t *dest, 
+    const uint64_t m, 
+    uint64_t *filled
+)
+{
+    const uint64_t len = n & ~1ULL;
+    
+    uint64_t *xor_bits;
+    uint64_t *same_bits;
+    uint64_t xor_len = 0;
+    uint64_t same_len = 0;
+    uint64_t read_pos = 0;
+    uint64_t pairs;
+    uint64_t diff;
+    uint64_t bits;
+    uint64_t count;
+    
+    if (depth == 0 || len == 0 || *filled == m) return;
+    
+    xor_bits = malloc((len / 128 + 1) * sizeof(uint64_t));
+    same_bits = malloc((len / 128 + 1) * sizeof(uint64_t));
+    
+    if (xor_bits == NULL || same_bits == NULL) goto cleanup;
+    
+    for (uint64_t i = 0; i < len; i += 64)
+    {
+        pairs = 0x5555555555555555ULL;
+        if (len - i < 64) pairs &= (1ULL << (len - i)) - 1;
+        
+        diff = (src[i / 64] ^ (src[i / 64] >> 1)) & pairs;
+        count = (uint64_t) __builtin_popcountll(pairs);
+        
+        bits_append(xor_bits, xor_len, bits_pext(diff, pairs), count);
+        xor_len += count;
+        
+        count -= (uint64_t) __builtin_popcountll(diff);
+        
+        bits_append(same_bits, same_len, bits_pext(src[i / 64], pairs & ~diff), count);
+        same_len += count;
+    }
+    
+    for (uint64_t i = 0; i < 2; i++)
+    {
+        const uint64_t *stream = i ? same_bits : xor_bits;
+        const uint64_t stream_len = (i ? same_len : xor_len) & ~1ULL;
+        
+        for (read_pos = 0; read_pos < stream_len && *filled < m;)
+        {
+            read_pos += vndb_word
+            (
+                stream[read_pos / 64], 
+                stream_len - read_pos, 
+                m - *filled, 
+                &bits, 
+                &count
+            );
+            
+            bits_append(dest, *filled, bits, count);
+            *filled += count;
+        }
+        
+        peres_pass(stream, stream_len, depth - 1, dest, m, filled);
+    }
+    
+    cleanup:
+        free(xor_bits);
+        free(same_bits);
+}
+
+/*******************************************************************************
+Debias the 32 bit-pairs of one word. A pair is discordant when its two bits
+differ, and then its output is its lower bit, so the discordant pairs are the
+low bits of w ^ (w >> 1) and PEXT gathers the outputs. If the word would fill
+the destination we stop right after the pair that writes the final bit, which
+is where the original pair-at-a-time loop stopped. n and m are the remaining
+source and destination bits, the return value is the number of bits used.
+*/
+
+static inline uint64_t vndb_word
+(
+    const uint64_t w, 
+    const uint64_t n, 
+    const uint64_t m, 
+    uint64_t * const x, 
+    uint64_t * const k
+)
+{
+    uint64_t pairs = (w ^ (w >> 1)) & 0x5555555555555555ULL;
+    uint64_t used = 64;
+    uint64_t last;
+    
+    if (n < 64)
+    {
+        pairs &= (1ULL << n) - 1;
+        used = n;
+    }
+    
+    *k = (uint64_t) __builtin_popcountll(pairs);
+    
+    if (*k >= m)
+    {
+        last = bits_select(pairs, m - 1);
+        pairs &= (2ULL << last) - 1;
+        used = last + 2;
+        *k = m;
+    }
+    
+    *x = bits_pext(w, pairs);
+    
+    return used;
+}
+
+/*******************************************************************************
+The x1 term of the lag-k cyclic autocorrelation restricted to source words [lo,
+hi). While the rotated view doesn't wrap, each of its words is a funnel shift of
+two source words. The last few words, where the view wraps back around to bit 0
+and where the source word is partial, go through the cyclic load instead.
+*/
+
+static uint64_t cycc_count
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const uint64_t k, 
+    const uint64_t lo, 
+    const uint64_t hi
+)
+{
+    const uint64_t q = k / 64;
+    const uint64_t r = k % 64;
+    const uint64_t fast = n >= k + 64 ? (n - k) / 64 : 0;
+    const uint64_t mid = fast < lo ? lo : (fast > hi ? hi : fast);
+    
+    uint64_t i = lo;
+    uint64_t x1 = 0;
+    uint64_t a;
+    uint64_t y;
+    
+    if (r == 0)
+    {
+        for (; i < mid; i++)
+        {
+            x1 += (uint64_t) __builtin_popcountll(src[i] & src[q + i]);
+        }
+    }
+    else
+    {
+        for (; i < mid; i++)
+        {
+            y = (src[q + i] >> r) | (src[q + i + 1] << (64 - r));
+            x1 += (uint64_t) __builtin_popcountll(src[i] & y);
+        }
+    }
+    
+    for (; i < hi; i++)
+    {
+        a = src[i];
+        
+        if (i * 64 + 64 > n) a &= ~0ULL >> (64 - n % 64);
+        
+        y = u64_bitarray_load_cyclic(src, (i * 64 + k) % n, n);
+        x1 += (uint64_t) __builtin_popcountll(a & y);
+    }
+    
+    return x1;
+}
+
+/*******************************************************************************
+The x2 term of the cyclic autocorrelation restricted to source words [lo, hi).
+*/
+
+static uint64_t cycc_popcount
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const uint64_t lo, 
+    const uint64_t hi
+)
+{
+    uint64_t x2 = 0;
+    
+    for (uint64_t i = lo; i < hi; i++)
+    {
+        if (i * 64 + 64 > n) 
+        {
+            x2 += (uint64_t) __builtin_popcountll(src[i] & (~0ULL >> (64 - n % 64)));
+        }
+        else
+        {
+            x2 += (uint64_t) __builtin_popcountll(src[i]);
+        }
+    }
+    
+    return x2;
+}
+
+/******************************************************************************/
+
+static double cycc_ratio
+(
+    const uint64_t n, 
+    const uint64_t x1, 
+    const uint64_t x2
+)
+{
+    double numerator = 
+        ((double) n * (double) x1 - ((double) x2 * (double) x2));
+    
+    double denominator =
+        ((double) n * (double) x2 - ((double) x2 * (double) x2));
+    
+    assert(numerator/denominator >= -1.0 && "lower bound violation");
+    assert(numerator/denominator <= 1.0 && "upper bound violation");
+    
+    return numerator/denominator;
+}
 
 /*******************************************************************************
-Since this is a non-crypto statistics library, I use rdrand instead of rdseed
-because it is A) faster since it doesn't require a pass through an extrator for
-full entropy and B) less or almost zero-prone to underflow. David Johnston
-explains this well in 13.4 of "Random Number Generators". Per Intel docs, rdrand
-is retried up to ten times per variable, hence the else clause goto fuckery. For
-PCG, ensure the increment is odd.
+Gather the bits of x under the mask into the low bits of the result. Modern
+AVX2 machines all have BMI2, the loop is only there for compilers without it.
 */
 
-random_t rng_init
+static inline uint64_t bits_pext
 (
-    const uint64_t seed
+    uint64_t x, 
+    uint64_t mask
 )
 {
-    random_t rng;
-    
-    if (seed != 0) 
-    {
-        rng.state = rng_hash(seed);
-        rng.increment = rng_hash(rng_hash(seed));
-    }
-    else
-    {
-        if (rdrand(&rng.state) && rdrand(&rng.increment))
+    #ifdef __BMI2__
+        return _pext_u64(x, mask);
+    #else
+        uint64_t result = 0;
+        
+        for (uint64_t bit = 1; mask; mask &= mask - 1, bit <<= 1)
         {
-            goto success;
+            if (x & mask & -mask) result |= bit;
         }
+        
+        return result;
+    #endif
+}
 
-        rng.state = 0;
-        rng.increment = 0;
-        goto terminate;
-    }
-    
-    success:
-        rng.increment |= 1;
-    
-    terminate:
-        return rng;
+/*******************************************************************************
+Position of the kth set bit of x, counting from zero. x has more than k bits.
+*/
+
+static inline uint64_t bits_select
+(
+    uint64_t x, 
+    uint64_t k
+)
+{
+    #ifdef __BMI2__
+        return (uint64_t) __builtin_ctzll(_pdep_u64(1ULL << k, x));
+    #else
+        for (; k; k--) x &= x - 1;
+        return (uint64_t) __builtin_ctzll(x);
+    #endif
 }
 
 /*******************************************************************************
-This function uses a virtual machine to interpret a portion of the bit pattern
-in the numerator parameter as executable bitcode. I wrote a short essay at url
-https://stackoverflow.com/questions/35795110/ (username Ollie) to demonstrate
-the concepts using 256 bits of resolution.
+Write the k low bits of x to the bit array at bit position pos, k <= 64. The
+bits above pos in its word must be zero, and any word that is entered for the
+first time is overwritten, so the destination never needs to be zeroed first.
 */
 
-uint64_t rng_bias 
+static inline void bits_append
 (
-    random_t * const rng, 
-    const uint64_t n, 
-    const int m
+    uint64_t *dest, 
+    uint64_t pos, 
+    uint64_t x, 
+    uint64_t k
 )
 {
-    assert(rng != NULL && "generator is null");
-    assert(n != 0 && "probability is 0");
-    assert(m > 0 && m <= 64 && "invalid base 2 exponent");
+    const uint64_t offset = pos % 64;
     
-    uint64_t accumulator = 0;
+    if (k == 0) return;
     
-    for (int pc = __builtin_ctzll(n); pc < m; pc++)
+    if (offset == 0)
     {
-        switch ((n >> pc) & 1)
-        {
-            case 0:
-                accumulator &= rng_next(rng);
-                break;
-                
-            case 1:
-                accumulator |= rng_next(rng);
-                break;
-        }
+        dest[pos / 64] = x;
+        return;
     }
     
-    return accumulator;
+    dest[pos / 64] |= x << offset;
+    
+    if (offset + k > 64) dest[pos / 64 + 1] = x >> (64 - offset);
 }
 
 /*******************************************************************************
-Von Neumann Debiaser for biased bits with no autocorrelation. Feed a low entropy
-n-bit bitstream into the debiaser, get a high-entropy at-most-m-bit bitstream.
-It may be that not all source bits are used and/or not all destination bits are
-filled. The source is read as consecutive bit-pairs. The destination must be
-zeroed out before the main loop since bitwise-or is used to set the bit array.
+Toeplitz hashing, y = Tx over GF(2) for a random k x 1024 Toeplitz matrix T. The
+matrix is fixed by its 1024 + k - 1 diagonals t, and y_i = sum x_j t_(i - j + 1023)
+is coefficient i + 1023 of the polynomial product x(z)t(z). So each block is one
+carry-less multiplication with PCLMULQDQ, of which we only keep the middle. By
+the leftover hash lemma, k = H - 2 log2(1/e) bits are within e of uniform when
+the block has min-entropy H, here e = 2^-32. Product words are built one at a
+time, summing every 64x64 partial product at that offset in a register, and
+only the words holding bits 1023 to 1023 + k are computed.
 */
 
-stream_t rng_vndb 
+stream_t rng_toep
 (
     const uint64_t * restrict src, 
     uint64_t * restrict dest, 
     const uint64_t n, 
-    const uint64_t m
+    const uint64_t m,
+    const double h,
+    const uint64_t seed
 )
-{  
+{
     assert(src != NULL && "null source");
     assert(dest != NULL && "null dest");
     assert(n != 0 && "nothing to read");
     assert(m != 0 && "nowhere to write");
-    assert(n % 2 == 0 && "cannot process odd-length bitstream");
+    assert(h > 0.0 && h <= 1.0 && "invalid min-entropy");
     
-    u64_bitarray(src);
-    u64_bitarray(dest);
+    const double bound = floor(1024.0 * h) - 64.0;
+    const uint64_t k = bound > 0.0 ? (uint64_t) bound : 0;
+    const uint64_t diagonals = (1024 + k - 1) / 64 + 1;
+    const uint64_t last = (1022 + k) / 64;
     
-    uint64_t write_pos = 0;
-    uint64_t read_pos = 0;
+    random_t rng = rng_init(seed);
+    uint64_t word;
+    uint64_t count;
+    uint64_t product[32] = {0};
+    __m128i t[31];
+    __m128i x[16];
+    __m128i acc;
+    __m128i prev;
     
     stream_t info = {.used = 0, .filled = 0};
-    memset(dest, 0, (m-1)/CHAR_BIT + 1);
+    
+    if (k == 0) return info;
+    
+    for (uint64_t j = 0; j < diagonals; j++)
+    {
+        word = rng_next(&rng);
         
-    while (read_pos < n)
-    {        
-        switch (u64_bitarray_mask_at(src, read_pos, 0x3ULL))
+        if (j == diagonals - 1 && (1024 + k - 1) % 64) 
         {
-            case 1:
-                u64_bitarray_set(dest, write_pos);
-                write_pos++;
-                break;
-            case 2:
-                write_pos++;
-                break;
+            word &= (1ULL << ((1024 + k - 1) % 64)) - 1;
+        }
+        
+        t[j] = _mm_cvtsi64_si128((long long) word);
+    }
+    
+    while (n - info.used >= 1024 && info.filled < m)
+    {
+        for (uint64_t i = 0; i < 16; i++)
+        {
+            x[i] = _mm_cvtsi64_si128((long long) src[info.used / 64 + i]);
+        }
+        
+        prev = _mm_setzero_si128();
+        
+        for (uint64_t w = 14; w <= last; w++)
+        {
+            acc = _mm_setzero_si128();
+            
+            for (uint64_t i = w < diagonals ? 0 : w - diagonals + 1; i < 16 && i <= w; i++)
+            {
+                acc = _mm_xor_si128(acc, _mm_clmulepi64_si128(x[i], t[w - i], 0x00));
+            }
+            
+            product[w] = (uint64_t) _mm_cvtsi128_si64(acc) 
+                       ^ (uint64_t) _mm_extract_epi64(prev, 1);
+            prev = acc;
         }
         
-        read_pos += 2;
+        product[last + 1] = (uint64_t) _mm_extract_epi64(prev, 1);
+        
+        for (uint64_t q = 0; q < k && info.filled < m; q += 64)
+        {
+            count = k - q < 64 ? k - q : 64;
+            if (count > m - info.filled) count = m - info.filled;
+            
+            bits_append
+            (
+                dest, 
+                info.filled, 
+                u64_bitarray_load(product, 1023 + q, 32 * 64) & (~0ULL >> (64 - count)), 
+                count
+            );
+            
+            info.filled += count;
+        }
         
-        if (write_pos == m) goto dest_filled;
+        info.used += 1024;
     }
     
-    dest_filled:
-        info.used = read_pos;
-        info.filled = write_pos;
-        return info;
+    if (info.filled < m)
+    {
+        uint64_t first = (info.filled + 63) / 64;
+        memset(dest + first, 0, ((m - 1) / 64 + 1 - first) * sizeof(uint64_t));
+    }
+    
+    return info;
 }
 
 /*******************************************************************************
 Cyclic lag-K autocorrelation of an n-bit stream. This uses the SCC algorithm
 from Donald Knuth as the base and adds the binary bit stream simplification
 from David Johnston's "Random Number Generators". 
+
+Both sums are taken a word at a time. x2 is the popcount of the stream and x1 is
+the popcount of the stream AND-ed with itself rotated down by K bits, see
+cycc_count.
 */
 
 double rng_cycc
@@ -161,37 +1167,300 @@ double rng_cycc
     assert(n != 0 && "no data");
     assert(k < n && "lag exceeds length of data");
     
-    u64_bitarray(src);
+    const uint64_t words = (n + 63) / 64;
+    
+    uint64_t x1 = cycc_count(src, n, k, 0, words);
+    uint64_t x2 = cycc_popcount(src, n, 0, words);
+    
+    return cycc_ratio(n, x1, x2);
+}
+
+/*******************************************************************************
+All lags in [k_lo, k_hi] in one pass over the stream. The stream is cut into
+blocks of 4 KB and every lag is run over a block before moving to the next one,
+so for lags up to a few thousand bits the rotated views of the block are still
+in L1 when the next lag reads them. The x2 term is shared by every lag and only
+counted once.
+*/
+
+void rng_cycc_range
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const uint64_t k_lo, 
+    const uint64_t k_hi, 
+    double *out
+)
+{
+    assert(src != NULL && "data pointer is null");
+    assert(out != NULL && "output pointer is null");
+    assert(n != 0 && "no data");
+    assert(k_lo <= k_hi && "empty lag range");
+    assert(k_hi < n && "lag exceeds length of data");
+    
+    const uint64_t block = 512;
+    const uint64_t words = (n + 63) / 64;
+    const uint64_t lags = k_hi - k_lo + 1;
+    
+    uint64_t *x1 = calloc(lags, sizeof(uint64_t));
+    assert(x1 != NULL && "calloc failure");
+    
+    uint64_t x2 = cycc_popcount(src, n, 0, words);
+    uint64_t end;
+    
+    for (uint64_t lo = 0; lo < words; lo += block)
+    {
+        end = lo + block < words ? lo + block : words;
+        
+        for (uint64_t j = 0; j < lags; j++)
+        {
+            x1[j] += cycc_count(src, n, k_lo + j, lo, end);
+        }
+    }
+    
+    for (uint64_t j = 0; j < lags; j++)
+    {
+        out[j] = cycc_ratio(n, x1[j], x2);
+    }
+    
+    free(x1);
+}
+
+/*******************************************************************************
+The stream is cut into segments of 64K words which the threads pick up in turn.
+Each segment reads across its own end and around the cyclic wrap through the
+full array, so no pair is lost at a boundary, and both sums are integers so the
+reduction is exact in any order.
+*/
+
+double rng_cycc_mt
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const uint64_t k, 
+    const int threads
+)
+{
+    assert(src != NULL && "data pointer is null");
+    assert(n != 0 && "no data");
+    assert(k < n && "lag exceeds length of data");
+    assert(threads >= 1 && "invalid thread count");
+    
+    const uint64_t segment = 1ULL << 16;
+    const uint64_t words = (n + 63) / 64;
+    const int64_t segments = (int64_t) ((words + segment - 1) / segment);
     
-    uint64_t i = 0;
     uint64_t x1 = 0;
     uint64_t x2 = 0;
     
-    while (i < n)
+    #pragma omp parallel for num_threads(threads) reduction(+:x1,x2)
+    for (int64_t i = 0; i < segments; i++)
+    {
+        uint64_t lo = (uint64_t) i * segment;
+        uint64_t hi = lo + segment < words ? lo + segment : words;
+        
+        x1 += cycc_count(src, n, k, lo, hi);
+        x2 += cycc_popcount(src, n, lo, hi);
+    }
+    
+    return cycc_ratio(n, x1, x2);
+}
+
+/******************************************************************************/
+
+uint64_t rng_popcount_mt
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const int threads
+)
+{
+    assert(src != NULL && "data pointer is null");
+    assert(threads >= 1 && "invalid thread count");
+    
+    const uint64_t segment = 1ULL << 16;
+    const uint64_t words = (n + 63) / 64;
+    const int64_t segments = (int64_t) ((words + segment - 1) / segment);
+    
+    uint64_t total = 0;
+    
+    #pragma omp parallel for num_threads(threads) reduction(+:total)
+    for (int64_t i = 0; i < segments; i++)
+    {
+        uint64_t lo = (uint64_t) i * segment;
+        uint64_t hi = lo + segment < words ? lo + segment : words;
+        
+        total += cycc_popcount(src, n, lo, hi);
+    }
+    
+    return total;
+}
+
+/*******************************************************************************
+Every buffer lives in one allocation. The ring must reach back one word past the
+largest lag so that the funnel shift in rng_cycc_stream always has both of its
+words, and it is rounded up to a power of 2 so that word positions are masked
+rather than divided.
+*/
+
+cycc_stream_t rng_cycc_stream_init
+(
+    const uint64_t * const lags, 
+    const uint64_t count
+)
+{
+    assert(lags != NULL && "lags pointer is null");
+    assert(count != 0 && "no lags");
+    
+    cycc_stream_t ctx = {0};
+    uint64_t k_max = 0;
+    uint64_t ring = 2;
+    
+    for (uint64_t j = 0; j < count; j++)
+    {
+        if (lags[j] > k_max) k_max = lags[j];
+    }
+    
+    while (ring < k_max / 64 + 2) ring <<= 1;
+    
+    ctx.count = count;
+    ctx.ring_mask = ring - 1;
+    ctx.head_words = (k_max + 63) / 64;
+    
+    uint64_t *mem = calloc(2 * count + ring + ctx.head_words, sizeof(uint64_t));
+    if (mem == NULL) return ctx;
+    
+    ctx.lags = mem;
+    ctx.x1 = mem + count;
+    ctx.ring = mem + 2 * count;
+    ctx.head = mem + 2 * count + ring;
+    
+    memcpy(ctx.lags, lags, count * sizeof(uint64_t));
+    
+    return ctx;
+}
+
+/*******************************************************************************
+Each new word w at word position t is paired with the 64 bits that sit k places
+before it, which are a funnel shift of the ring words at t - k/64 and the one
+before that. Pairs that would reach before the start of the stream belong to the
+cyclic closure; their ring slots have never been written, and since the ring is
+larger than the reach of any lag, they read as zero.
+*/
+
+void rng_cycc_stream
+(
+    cycc_stream_t * const ctx, 
+    const uint64_t * const src, 
+    const uint64_t n
+)
+{
+    assert(ctx != NULL && "accumulator is null");
+    assert(ctx->x1 != NULL && "accumulator is not initialized");
+    assert(src != NULL && "data pointer is null");
+    assert(ctx->n % 64 == 0 && "partial word was not the last call");
+    
+    const uint64_t words = (n + 63) / 64;
+    uint64_t t = ctx->n / 64;
+    uint64_t w;
+    uint64_t q;
+    uint64_t r;
+    uint64_t y;
+    
+    for (uint64_t i = 0; i < words; i++, t++)
     {
-        if (u64_bitarray_test(src, i))
-        {            
-            if (u64_bitarray_test(src, (i + k) % n))
+        w = src[i];
+        
+        if (i * 64 + 64 > n) w &= ~0ULL >> (64 - n % 64);
+        
+        ctx->ring[t & ctx->ring_mask] = w;
+        if (t < ctx->head_words) ctx->head[t] = w;
+        
+        ctx->x2 += (uint64_t) __builtin_popcountll(w);
+        
+        for (uint64_t j = 0; j < ctx->count; j++)
+        {
+            q = ctx->lags[j] / 64;
+            r = ctx->lags[j] % 64;
+            
+            y = ctx->ring[(t - q) & ctx->ring_mask];
+            
+            if (r != 0)
             {
-                x1++;
+                y = (y << r) | (ctx->ring[(t - q - 1) & ctx->ring_mask] >> (64 - r));
             }
             
-            x2++;
+            ctx->x1[j] += (uint64_t) __builtin_popcountll(w & y);
         }
-        
-        i++;
-    }    
+    }
     
-    double numerator = 
-        ((double) n * (double) x1 - ((double) x2 * (double) x2));
+    ctx->n += n;
+}
+
+/*******************************************************************************
+The closure pairs the last k bits of the stream with the first k bits. Both are
+still held by the accumulator, so they are combined on the fly and the running
+counts are left untouched for the next chunk.
+*/
+
+void rng_cycc_stream_result
+(
+    const cycc_stream_t * const ctx, 
+    double *out
+)
+{
+    assert(ctx != NULL && "accumulator is null");
+    assert(ctx->x1 != NULL && "accumulator is not initialized");
+    assert(out != NULL && "output pointer is null");
     
-    double denominator =
-        ((double) n * (double) x2 - ((double) x2 * (double) x2));
+    const uint64_t n = ctx->n;
+    const uint64_t last = (n - 1) / 64;
+    uint64_t k;
+    uint64_t x1;
+    uint64_t p;
+    uint64_t y;
+    uint64_t a;
     
-    assert(numerator/denominator >= -1.0 && "lower bound violation");
-    assert(numerator/denominator <= 1.0 && "upper bound violation");
+    for (uint64_t j = 0; j < ctx->count; j++)
+    {
+        k = ctx->lags[j];
+        x1 = ctx->x1[j];
+        
+        assert(k < n && "lag exceeds length of data");
+        
+        for (uint64_t d = 0; d < k; d += 64)
+        {
+            p = n - k + d;
+            y = ctx->ring[(p / 64) & ctx->ring_mask] >> (p % 64);
+            
+            if (p % 64 != 0 && p / 64 < last)
+            {
+                y |= ctx->ring[(p / 64 + 1) & ctx->ring_mask] << (64 - p % 64);
+            }
+            
+            a = ctx->head[d / 64];
+            
+            if (k - d < 64) a &= ~0ULL >> (64 - (k - d));
+            
+            x1 += (uint64_t) __builtin_popcountll(a & y);
+        }
+        
+        out[j] = cycc_ratio(n, x1, ctx->x2);
+    }
+}
+
+/******************************************************************************/
+
+void rng_cycc_stream_free(cycc_stream_t * const ctx)
+{
+    assert(ctx != NULL && "accumulator is null");
     
-    return numerator/denominator;
+    free(ctx->lags);
+    
+    ctx->lags = NULL;
+    ctx->x1 = NULL;
+    ctx->ring = NULL;
+    ctx->head = NULL;
 }
 
 /*******************************************************************************
@@ -211,6 +1480,8 @@ uint64_t rng_rand
     assert(rng != NULL && "generator is null");
     assert(min < max && "bounds violation");
     
+    INSTRUMENT_BEGIN(rng);
+    
     uint64_t sample;
     uint64_t scaled_max = max - min;
     uint64_t bitmask = ~((uint64_t) 0) >> __builtin_clzll(scaled_max);
@@ -226,6 +1497,8 @@ uint64_t rng_rand
     
     assert(sample <= scaled_max && "scaled bounds violation");
     
+    INSTRUMENT_END(API_RNG_RAND, rng);
+    
     return sample + min;
 }
 
@@ -247,6 +1520,8 @@ uint64_t rng_bino
     assert(m > 0 && m <= 64 && "invalid base 2 exponent");
     assert(k != 0 && "no trials");
     
+    INSTRUMENT_BEGIN(rng);
+    
     uint64_t success = 0;
     
     for (; k > 64; k-= 64)
@@ -254,7 +1529,11 @@ uint64_t rng_bino
         success += (uint64_t) __builtin_popcountll(rng_bias(rng, n, m));
     }
     
-    return success + (uint64_t) __builtin_popcountll(rng_bias(rng, n, m) >> (64 - k));
+    success += (uint64_t) __builtin_popcountll(rng_bias(rng, n, m) >> (64 - k));
+    
+    INSTRUMENT_END(API_RNG_BINO, rng);
+    
+    return success;
 }
 
 /*******************************************************************************
@@ -279,9 +1558,27 @@ uint64_t rng_next
 {
     uint64_t x = rng->state;
     
+    INSTRUMENT_DRAW(rng);
+    
     rng->state = rng->state * 0x5851F42D4C957F2DULL + rng->increment;
     
     uint64_t fx = ((x >> ((x >> 59ULL) + 5ULL)) ^ x) * 0xAEF17502108EF2D9ULL;
     
     return (fx >> 43ULL) ^ fx;
 }
+
+#ifdef RNG_INSTRUMENT
+
+/******************************************************************************/
+
+double rng_period_used
+(
+    const random_t * const rng
+)
+{
+    assert(rng != NULL && "generator is null");
+    
+    return ldexp((double) rng->draws, -64);
+}
+
+#endif
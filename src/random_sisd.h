@@ -8,17 +8,23 @@
 #define SISD_RANDOM_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 /*******************************************************************************
 * NAME: random_t
 * DESC: internal state of the default PRNG
 * @ current : state value used to generate PRNG values
 * @ increment : stream identifier
+* @ draws : outputs drawn since initialization, RNG_INSTRUMENT builds only
 *******************************************************************************/
 typedef struct
 {
     uint64_t state;
     uint64_t increment;
+    #ifdef RNG_INSTRUMENT
+        uint64_t draws;
+    #endif
 } random_t;
     
 /*******************************************************************************
@@ -33,6 +39,74 @@ typedef struct
     uint64_t filled;
 } stream_t;
 
+/*******************************************************************************
+* NAME: markov_t
+* DESC: state of a two-state markov chain bitstream, see rng_markov_init
+* @ n : numerators of the 0 -> 1 and 1 -> 0 transition probabilities
+* @ cache : unused bernoulli trials for leaving state 0 and state 1
+* @ log_q : log(1 - p) when the run length is sampled by inversion, else zero
+* @ run : bits of the current run that have not been written yet
+* @ state : value of the current run
+* @ m : base 2 exponents of the transition probabilities
+* @ avail : total unused trials in each cache word
+*******************************************************************************/
+typedef struct
+{
+    uint64_t n[2];
+    uint64_t cache[2];
+    double log_q[2];
+    uint64_t run;
+    uint64_t state;
+    int m[2];
+    int avail[2];
+} markov_t;
+
+/*******************************************************************************
+* NAME: vndb_stream_t
+* DESC: state of a resumable Von Neumann Debiaser, see rng_vndb_stream_init
+* @ ring : caller buffer which receives the output bitstream
+* @ size : capacity of the ring in bits
+* @ head : bit position in the ring where the next output bit is written
+* @ total : total bits written since initialization
+* @ pending : first bit of a pair which was split between two calls
+* @ has_pending : 1 if pending holds a bit, else 0
+*******************************************************************************/
+typedef struct
+{
+    uint64_t *ring;
+    uint64_t size;
+    uint64_t head;
+    uint64_t total;
+    uint64_t pending;
+    uint64_t has_pending;
+} vndb_stream_t;
+
+/*******************************************************************************
+* NAME: cycc_stream_t
+* DESC: state of an online cyclic autocorrelation, see rng_cycc_stream_init
+* @ lags : copy of the autocorrelation lags being tracked
+* @ x1 : per-lag count of set bit pairs seen so far, without the cyclic closure
+* @ ring : the last ring_mask + 1 words of the stream, indexed by word position
+* @ head : the first head_words words of the stream
+* @ count : number of lags
+* @ ring_mask : ring size minus one, the ring size is a power of 2
+* @ head_words : words needed to hold the first bits for the largest lag
+* @ x2 : set bits seen so far
+* @ n : bits seen so far
+*******************************************************************************/
+typedef struct
+{
+    uint64_t *lags;
+    uint64_t *x1;
+    uint64_t *ring;
+    uint64_t *head;
+    uint64_t count;
+    uint64_t ring_mask;
+    uint64_t head_words;
+    uint64_t x2;
+    uint64_t n;
+} cycc_stream_t;
+
 /*******************************************************************************
 * NAME: rng_init
 * DESC: initialize a variable of type random_t
@@ -41,6 +115,22 @@ typedef struct
 *******************************************************************************/
 random_t rng_init(const uint64_t seed);
 
+/*******************************************************************************
+* NAME: rng_init_many
+* DESC: initialize an array of random_t with distinct states and odd increments
+*       from consecutive outputs of SplitMix64, four words per AVX2 hash
+* OUTP: false if seed = 0 and no seed word could be drawn, the array is zeroed
+* NOTE: streams differ from those of rng_init with the same seed
+* @ seed : set seed = 0 for a single non-deterministic seed word
+* @ rng : array of count generators
+*******************************************************************************/
+bool rng_init_many
+(
+    const uint64_t seed, 
+    random_t * const rng, 
+    const size_t count
+);
+
 /*******************************************************************************
 * NAME: rng_generator
 * DESC: generate a psuedo random number via the default PRNG.
@@ -48,6 +138,17 @@ random_t rng_init(const uint64_t seed);
 *******************************************************************************/
 uint64_t rng_next(random_t * const rng);
 
+#ifdef RNG_INSTRUMENT
+
+/*******************************************************************************
+* NAME: rng_period_used
+* DESC: fraction of the 2^64 period drawn since initialization
+* OUTP: draws / 2^64
+*******************************************************************************/
+double rng_period_used(const random_t * const rng);
+
+#endif
+
 /*******************************************************************************
 * NAME: rng_rand
 * DESC: generate an unbiased psuedo random number
@@ -67,6 +168,73 @@ uint64_t rng_rand(random_t * const rng, const uint64_t min, const uint64_t max);
 *******************************************************************************/
 uint64_t rng_bias(random_t * const rng, const uint64_t n, const int m);
 
+/*******************************************************************************
+* NAME: rng_bias_lanes
+* DESC: rng_bias where each of the 64 bit positions has its own probability
+* OUTP: 64-bit word where bit j has probability p_j = n_j/2^m of success
+* NOTE: a lane with a zero numerator is never set
+* @ planes : m bit planes, bit j of planes[i] is bit i of numerator n_j
+* @ m : nonzero base 2 exponent less than or equal to 64
+*******************************************************************************/
+uint64_t rng_bias_lanes
+(
+    random_t * const rng,
+    const uint64_t * const planes,
+    const int m
+);
+
+/*******************************************************************************
+* NAME: rng_kmask
+* DESC: random bit array of length n with exactly k bits set
+* OUTP: dest holds a uniformly chosen k-subset of n bits, bits beyond n cleared
+* @ dest : bit array with space for n bits, rounded up to a 64-bit word
+* @ n : nonzero total bits
+* @ k : total set bits not exceeding n
+*******************************************************************************/
+void rng_kmask
+(
+    random_t * const rng, 
+    uint64_t * const dest, 
+    const uint64_t n, 
+    const uint64_t k
+);
+
+/*******************************************************************************
+* NAME: rng_markov_init
+* DESC: initialize a two-state markov chain with transition probabilities
+* OUTP: chain which starts in the given state
+* @ state : 0 or 1, the value of the first bit in the stream
+* @ n01 : nonzero numerator of P(0 -> 1), strictly less than 2^m01
+* @ m01 : nonzero base 2 exponent less than or equal to 64
+* @ n10 : nonzero numerator of P(1 -> 0), strictly less than 2^m10
+* @ m10 : nonzero base 2 exponent less than or equal to 64
+*******************************************************************************/
+markov_t rng_markov_init
+(
+    const int state,
+    const uint64_t n01,
+    const int m01,
+    const uint64_t n10,
+    const int m10
+);
+
+/*******************************************************************************
+* NAME: rng_markov
+* DESC: generate the next n bits of a two-state markov chain bitstream
+* OUTP: dest holds n bits, bits beyond n in the last word are cleared
+* NOTE: consecutive calls continue the same stream, for any chunk length
+* @ chain : markov chain from rng_markov_init
+* @ dest : bit array with space for n bits, rounded up to a 64-bit word
+* @ n : total bits
+*******************************************************************************/
+void rng_markov
+(
+    random_t * const rng,
+    markov_t * const chain,
+    uint64_t * const dest,
+    const uint64_t n
+);
+
 /*******************************************************************************
 * NAME: rng_vndb
 * DESC: Von Neumann Debiaser for iid biased bits with zero autocorrelation
@@ -83,6 +251,73 @@ stream_t rng_vndb
     const uint64_t m
 );
 
+/*******************************************************************************
+* NAME: rng_vndb_stream_init
+* DESC: initialize a resumable Von Neumann Debiaser writing into a ring buffer
+* OUTP: debiaser with an empty pending pair and its head at the start of ring
+* @ ring : output buffer, its contents are overwritten as the head reaches them
+* @ size : nonzero capacity of the ring in bits, a multiple of 64
+*******************************************************************************/
+vndb_stream_t rng_vndb_stream_init(uint64_t * const ring, const uint64_t size);
+
+/*******************************************************************************
+* NAME: rng_vndb_stream
+* DESC: Von Neumann Debiaser that continues the stream from its previous call
+* OUTP: stream_t.filled bits written at the head, which used stream_t.used bits
+* NOTE: n may be odd, a trailing unpaired bit is kept and counts as used
+* NOTE: unused source bits exist only when m is reached, resume from them
+* @ src : binary bit stream of length n bits
+* @ m : nonzero cap on output bits for this call, not exceeding the ring size
+*******************************************************************************/
+stream_t rng_vndb_stream
+(
+    vndb_stream_t * const ctx,
+    const uint64_t * const src,
+    const uint64_t n,
+    const uint64_t m
+);
+
+/*******************************************************************************
+* NAME: rng_peres
+* DESC: Peres iterated Von Neumann Debiaser for iid biased bits
+* OUTP: dest is filled with stream_t.filled bits, which used stream_t.used bits
+* NOTE: depth 1 is rng_vndb, each extra level recovers more of the entropy
+* NOTE: stream_t.used is n unless dest is filled by the first Von Neumann pass
+* @ src : binary bit stream of length n bits
+* @ dest : binary bit stream of length m bits
+* @ depth : nonzero levels of recursion
+*******************************************************************************/
+stream_t rng_peres
+(
+    const uint64_t * restrict src, 
+    uint64_t * restrict dest, 
+    const uint64_t n, 
+    const uint64_t m,
+    const int depth
+);
+
+/*******************************************************************************
+* NAME: rng_toep
+* DESC: Toeplitz hashing extractor for sources with bias and/or autocorrelation
+* OUTP: dest is filled with stream_t.filled bits, which used stream_t.used bits
+* NOTE: each 1024-bit block outputs 1024h - 64 bits at statistical distance 2^-32
+* NOTE: a trailing partial block is not used, the block that fills dest is
+* NOTE: the diagonals of the matrix are successive rng_next words of the seed
+* @ src : binary bit stream of length n bits
+* @ dest : binary bit stream of length m bits
+* @ h : estimated min-entropy per source bit, in range (0, 1]
+* @ seed : rng_init seed of the public Toeplitz matrix
+*******************************************************************************/
+stream_t rng_toep
+(
+    const uint64_t * restrict src, 
+    uint64_t * restrict dest, 
+    const uint64_t n, 
+    const uint64_t m,
+    const double h,
+    const uint64_t seed
+);
+
 /*******************************************************************************
 * NAME: rng_cycc
 * DESC: calculate the cyclic autocorrelation of an n-bit binary bitstream
@@ -92,6 +327,91 @@ stream_t rng_vndb
 *******************************************************************************/
 double rng_cycc(const uint64_t *src, const uint64_t n, const uint64_t k);
 
+/*******************************************************************************
+* NAME: rng_cycc_range
+* DESC: calculate the cyclic autocorrelation at every lag in [k_lo, k_hi] in one
+*       cache-blocked pass over an n-bit binary bitstream
+* OUTP: out[k - k_lo] is rng_cycc(src, n, k), bit for bit
+* @ src : binary bit stream of length n bits
+* @ k_lo : smallest autocorrelation lag
+* @ k_hi : largest autocorrelation lag, not less than k_lo and less than n
+* @ out : array of k_hi - k_lo + 1 correlations
+*******************************************************************************/
+void rng_cycc_range
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const uint64_t k_lo, 
+    const uint64_t k_hi, 
+    double *out
+);
+
+/*******************************************************************************
+* NAME: rng_cycc_mt
+* DESC: rng_cycc split across threads with OpenMP for very large bitstreams
+* OUTP: same result as rng_cycc, bit for bit
+* @ src : binary bit stream of length n bits
+* @ k : autocorrelation lag, less than n
+* @ threads : number of threads, at least 1
+*******************************************************************************/
+double rng_cycc_mt
+(
+    const uint64_t *src, 
+    const uint64_t n, 
+    const uint64_t k, 
+    const int threads
+);
+
+/*******************************************************************************
+* NAME: rng_popcount_mt
+* DESC: count the set bits of an n-bit binary bitstream across threads
+* OUTP: number of 1 bits in the first n bits of src
+* @ src : binary bit stream of length n bits
+* @ threads : number of threads, at least 1
+*******************************************************************************/
+uint64_t rng_popcount_mt(const uint64_t *src, const uint64_t n, const int threads);
+
+/*******************************************************************************
+* NAME: rng_cycc_stream_init
+* DESC: initialize an online cyclic autocorrelation over a set of lags
+* OUTP: empty accumulator, a null x1 pointer indicates allocation failure
+* NOTE: memory is a few words per lag plus two copies of the largest lag in bits
+* @ lags : array of autocorrelation lags, copied into the accumulator
+* @ count : nonzero number of lags
+*******************************************************************************/
+cycc_stream_t rng_cycc_stream_init(const uint64_t * const lags, const uint64_t count);
+
+/*******************************************************************************
+* NAME: rng_cycc_stream
+* DESC: add the next n bits of a bitstream to an online cyclic autocorrelation
+* NOTE: n must be a multiple of 64 on every call except the last one
+* @ ctx : accumulator from rng_cycc_stream_init
+* @ src : binary bit stream of length n bits
+*******************************************************************************/
+void rng_cycc_stream
+(
+    cycc_stream_t * const ctx, 
+    const uint64_t * const src, 
+    const uint64_t n
+);
+
+/*******************************************************************************
+* NAME: rng_cycc_stream_result
+* DESC: lag correlations of all bits seen so far, the accumulator is unchanged
+* OUTP: out[j] is rng_cycc over the bits seen so far at lag ctx.lags[j]
+* NOTE: every lag must be less than the number of bits seen so far
+* @ ctx : accumulator from rng_cycc_stream_init
+* @ out : array of ctx.count correlations
+*******************************************************************************/
+void rng_cycc_stream_result(const cycc_stream_t * const ctx, double *out);
+
+/*******************************************************************************
+* NAME: rng_cycc_stream_free
+* DESC: release the memory of an online cyclic autocorrelation
+* @ ctx : accumulator from rng_cycc_stream_init, its pointers are set to null
+*******************************************************************************/
+void rng_cycc_stream_free(cycc_stream_t * const ctx);
+
 /*******************************************************************************
 * NAME: rng_binomial
 * DESC: sample from a binomial distribution X~(k,p) where p = n/2^m
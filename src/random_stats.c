@@ -0,0 +1,2087 @@
+/*
+* NAME: Copyright (c) 2020, Biren Patel
+* LISC: MIT License
+* DESC: Statistical tests and entropy estimates on bitarrays, and goodness of fit
+* tests for samplers implementation
+*/
+
+#include "random_stats.h"
+#include "bitarray.h"
+
+#include <immintrin.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define Z_99 2.576
+#define LOG_TABLE 4096
+#define BLOCK_BITS 6
+#define BLOCK_VALUES 64
+#define DICTIONARY 1000
+#define CHUNK_BITS 393216
+#define NONE UINT64_MAX
+#define MAX_PATTERN 24
+#define IGAM_EPSILON 1e-15
+#define IGAM_LIMIT 1000000
+#define RANK_SIZE 32
+#define COMPLEXITY_BLOCK 500
+#define SAMPLE_BUFFER 1024
+#define KS_PI 3.14159265358979323846
+
+/*******************************************************************************
+Partial counts over one chunk of a capture, see rng_entropy. The collision walk
+is run from each of the three positions at which the walk of the previous chunk
+can exit, and the compression walk keeps the first and last block index of each
+value so that the distances across the chunk boundary can be filled in later.
+*/
+
+typedef struct
+{
+    uint64_t ones;
+    uint64_t pairs;
+    uint64_t collisions[3][2];
+    uint64_t exit[3];
+    uint64_t first[BLOCK_VALUES];
+    uint64_t last[BLOCK_VALUES];
+    double sum;
+    double square;
+} tally_t;
+
+//static prototypes
+static uint64_t stats_popcount(const uint64_t *src, uint64_t begin, uint64_t end);
+static uint64_t stats_pairs(const uint64_t *src, uint64_t n, uint64_t begin, uint64_t end);
+static void stats_collision_table(uint8_t table[3][1024]);
+static uint64_t stats_collision_walk
+(
+    const uint64_t *src,
+    uint64_t n,
+    uint64_t pos,
+    uint64_t end,
+    uint8_t table[3][1024],
+    uint64_t counts[2]
+);
+static void stats_log_table(double *table);
+static void stats_compression_walk
+(
+    const uint64_t *src,
+    uint64_t begin,
+    uint64_t end,
+    const double *log_table,
+    tally_t *tally
+);
+static double stats_mcv(uint64_t n, uint64_t ones);
+static double stats_collision(const uint64_t counts[2]);
+static double stats_markov(const uint64_t *src, uint64_t n, uint64_t ones, uint64_t pairs);
+static double stats_compression(const tally_t *tallies, uint64_t chunks, uint64_t n);
+static double stats_maurer_g(double z, uint64_t blocks);
+static uint64_t stats_longest(const uint64_t *src, uint64_t n, uint64_t begin, uint64_t end);
+static void stats_patterns(const uint64_t *src, uint64_t n, int m, uint64_t *counts);
+static void stats_marginal(uint64_t *counts, int m);
+static double stats_psi2(const uint64_t *counts, int m, uint64_t n);
+static double stats_phi(const uint64_t *counts, int m, uint64_t n);
+static void stats_serial(uint64_t *counts, int m, uint64_t n, double p[2]);
+static uint64_t stats_berlekamp
+(
+    const uint64_t *src,
+    uint64_t n,
+    uint64_t begin,
+    uint64_t m,
+    uint64_t *work
+);
+static double stats_rank_probability(int rank, int size);
+static double stats_cusum(uint64_t n, uint64_t z);
+static double stats_igamc(double a, double x);
+static void stats_bin(const uint64_t *src, uint64_t n, uint64_t *sub, uint64_t bins);
+static void stats_fold(const uint64_t *sub, uint64_t *counts, uint64_t bins);
+static double stats_kolmogorov(double lambda);
+
+/*******************************************************************************
+The simplest estimator only needs the number of ones, which is a popcount of the
+whole stream.
+*/
+
+double rng_entropy_mcv
+(
+    const uint64_t * const src,
+    const uint64_t n
+)
+{
+    assert(src != NULL && "null source");
+    assert(n >= 2 && "too few samples");
+
+    return stats_mcv(n, stats_popcount(src, 0, n));
+}
+
+/*******************************************************************************
+With two symbols a collision always happens within three samples, so the stream
+is parsed into pairs of equal bits and triples whose first two bits differ. The
+parse is driven by a table over bytes, see stats_collision_table.
+*/
+
+double rng_entropy_collision
+(
+    const uint64_t * const src,
+    const uint64_t n
+)
+{
+    assert(src != NULL && "null source");
+    assert(n >= 6 && "too few samples");
+
+    uint8_t table[3][1024];
+    uint64_t counts[2] = {0, 0};
+
+    stats_collision_table(table);
+    stats_collision_walk(src, n, 0, n, table, counts);
+
+    return stats_collision(counts);
+}
+
+/*******************************************************************************
+The four transition counts follow from the number of ones, the number of 11
+pairs, and the first and last bits of the stream. The 11 pairs are counted by
+AND-ing the stream with itself shifted down by one bit.
+*/
+
+double rng_entropy_markov
+(
+    const uint64_t * const src,
+    const uint64_t n
+)
+{
+    assert(src != NULL && "null source");
+    assert(n >= 2 && "too few samples");
+
+    return stats_markov
+    (
+        src,
+        n,
+        stats_popcount(src, 0, n),
+        stats_pairs(src, n, 0, n)
+    );
+}
+
+/*******************************************************************************
+The first 1000 blocks fill the dictionary of last occurrences and the remaining
+blocks are tested. Distances are read from a table of logarithms when they are
+short, which is almost always the case for a source with any entropy.
+*/
+
+double rng_entropy_compression
+(
+    const uint64_t * const src,
+    const uint64_t n
+)
+{
+    assert(src != NULL && "null source");
+    assert(n / BLOCK_BITS > DICTIONARY + 1 && "too few samples");
+
+    double *log_table = malloc(LOG_TABLE * sizeof(double));
+    assert(log_table != NULL && "malloc failure");
+
+    tally_t tally;
+
+    stats_log_table(log_table);
+    stats_compression_walk(src, 0, n / BLOCK_BITS, log_table, &tally);
+    free(log_table);
+
+    return stats_compression(&tally, 1, n);
+}
+
+/*******************************************************************************
+The capture is split into chunks which are a multiple of both 64 and 6 bits, so
+every chunk begins on a word and on a compression block. Each chunk is tallied
+independently on its own thread and the tallies are then merged in order. The
+only state that crosses a boundary is the position of the collision parse and
+the dictionary of the compression estimator, and both are stitched exactly. The
+three collision parses of a chunk almost always meet within the first word, so
+only one of them is continued past that point unless they never met.
+*/
+
+entropy_t rng_entropy
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const int threads
+)
+{
+    assert(src != NULL && "null source");
+    assert(n / BLOCK_BITS > DICTIONARY + 1 && "too few samples");
+    assert(threads >= 1 && "invalid thread count");
+
+    const uint64_t chunks = (n + CHUNK_BITS - 1) / CHUNK_BITS;
+
+    tally_t *tallies = malloc(chunks * sizeof(tally_t));
+    double *log_table = malloc(LOG_TABLE * sizeof(double));
+    assert(tallies != NULL && log_table != NULL && "malloc failure");
+
+    uint8_t table[3][1024];
+    stats_collision_table(table);
+    stats_log_table(log_table);
+
+    #pragma omp parallel for num_threads(threads) schedule(dynamic)
+    for (uint64_t c = 0; c < chunks; c++)
+    {
+        const uint64_t begin = c * CHUNK_BITS;
+        const uint64_t end = begin + CHUNK_BITS < n ? begin + CHUNK_BITS : n;
+        tally_t *tally = tallies + c;
+
+        tally->ones = stats_popcount(src, begin, end);
+        tally->pairs = stats_pairs(src, n, begin, end);
+
+        const uint64_t sync = begin + 64 < end ? begin + 64 : end;
+        uint64_t rest[2] = {0, 0};
+        uint64_t join;
+
+        for (uint64_t i = 0; i < 3; i++)
+        {
+            tally->collisions[i][0] = 0;
+            tally->collisions[i][1] = 0;
+            tally->exit[i] = stats_collision_walk
+            (
+                src, n, begin + i, sync, table, tally->collisions[i]
+            );
+        }
+
+        join = tally->exit[0];
+        tally->exit[0] = stats_collision_walk(src, n, join, end, table, rest);
+
+        for (uint64_t i = 0; i < 3; i++)
+        {
+            if (i == 0 || tally->exit[i] == join)
+            {
+                tally->collisions[i][0] += rest[0];
+                tally->collisions[i][1] += rest[1];
+                tally->exit[i] = tally->exit[0];
+            }
+            else
+            {
+                tally->exit[i] = stats_collision_walk
+                (
+                    src, n, tally->exit[i], end, table, tally->collisions[i]
+                );
+            }
+        }
+
+        stats_compression_walk
+        (
+            src, begin / BLOCK_BITS, end / BLOCK_BITS, log_table, tally
+        );
+    }
+
+    uint64_t ones = 0;
+    uint64_t pairs = 0;
+    uint64_t counts[2] = {0, 0};
+    uint64_t pos = 0;
+
+    for (uint64_t c = 0; c < chunks; c++)
+    {
+        const uint64_t begin = c * CHUNK_BITS;
+        const uint64_t end = begin + CHUNK_BITS < n ? begin + CHUNK_BITS : n;
+
+        ones += tallies[c].ones;
+        pairs += tallies[c].pairs;
+
+        if (pos < end)
+        {
+            counts[0] += tallies[c].collisions[pos - begin][0];
+            counts[1] += tallies[c].collisions[pos - begin][1];
+            pos = tallies[c].exit[pos - begin];
+        }
+    }
+
+    entropy_t entropy =
+    {
+        .mcv = stats_mcv(n, ones),
+        .collision = stats_collision(counts),
+        .markov = stats_markov(src, n, ones, pairs),
+        .compression = stats_compression(tallies, chunks, n),
+        .min = 1.0
+    };
+
+    entropy.min = fmin(fmin(entropy.mcv, entropy.collision), entropy.min);
+    entropy.min = fmin(fmin(entropy.markov, entropy.compression), entropy.min);
+
+    free(tallies);
+    free(log_table);
+
+    return entropy;
+}
+
+/*******************************************************************************
+The statistic only needs the number of ones, which is the same AVX2 popcount
+used by the entropy estimators.
+*/
+
+double rng_nist_frequency
+(
+    const uint64_t * const src,
+    const uint64_t n
+)
+{
+    assert(src != NULL && "null source");
+    assert(n != 0 && "no data");
+
+    const double sum = 2.0 * (double) stats_popcount(src, 0, n) - (double) n;
+
+    return erfc(fabs(sum) / sqrt(2.0 * (double) n));
+}
+
+/*******************************************************************************
+Each block is a range popcount, which runs a word at a time whenever the block
+length is a multiple of 64.
+*/
+
+double rng_nist_block_frequency
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const uint64_t m
+)
+{
+    assert(src != NULL && "null source");
+    assert(m != 0 && "empty block");
+    assert(n >= m && "too few samples");
+
+    const uint64_t blocks = n / m;
+    double chi = 0.0;
+    double pi;
+
+    for (uint64_t i = 0; i < blocks; i++)
+    {
+        pi = (double) stats_popcount(src, i * m, i * m + m) / (double) m - 0.5;
+        chi += pi * pi;
+    }
+
+    chi *= 4.0 * (double) m;
+
+    return stats_igamc((double) blocks / 2.0, chi / 2.0);
+}
+
+/*******************************************************************************
+Bits i and i + 1 differ when b_i + b_i+1 - 2 b_i b_i+1 is 1, so the number of
+runs follows from the number of ones and the number of 11 pairs without another
+pass over the stream.
+*/
+
+double rng_nist_runs
+(
+    const uint64_t * const src,
+    const uint64_t n
+)
+{
+    assert(src != NULL && "null source");
+    assert(n >= 2 && "too few samples");
+
+    const uint64_t ones = stats_popcount(src, 0, n);
+    const uint64_t pairs = stats_pairs(src, n, 0, n);
+    const uint64_t edges = (src[0] & 1) + ((src[(n - 1) / 64] >> ((n - 1) % 64)) & 1);
+    const double total = (double) n;
+    const double pi = (double) ones / total;
+    const double pq = pi * (1.0 - pi);
+
+    if (fabs(pi - 0.5) >= 2.0 / sqrt(total)) return 0.0;
+
+    const double runs = (double) (2 * ones - edges - 2 * pairs + 1);
+
+    return erfc(fabs(runs - 2.0 * total * pq) / (2.0 * sqrt(2.0 * total) * pq));
+}
+
+/*******************************************************************************
+Block lengths and category bounds of table 2.4.2 of the standard, with the more
+precise category probabilities of the reference implementation for the two
+shorter blocks. Longest runs at or below the first bound fall in the first
+category and those at or above the last bound fall in the last one.
+*/
+
+double rng_nist_longest_run
+(
+    const uint64_t * const src,
+    const uint64_t n
+)
+{
+    assert(src != NULL && "null source");
+    assert(n >= 128 && "too few samples");
+
+    static const double table_8[7] = {0.21484375, 0.3671875, 0.23046875, 0.1875};
+    static const double table_128[7] =
+    {
+        0.1174035788, 0.242955959, 0.249363483, 0.17517706, 0.102701071, 0.112398847
+    };
+    static const double table_10000[7] =
+    {
+        0.0882, 0.2092, 0.2483, 0.1933, 0.1208, 0.0675, 0.0727
+    };
+
+    const double *pi = table_8;
+    uint64_t m = 8;
+    uint64_t low = 1;
+    uint64_t k = 3;
+
+    if (n >= 750000)
+    {
+        pi = table_10000;
+        m = 10000;
+        low = 10;
+        k = 6;
+    }
+    else if (n >= 6272)
+    {
+        pi = table_128;
+        m = 128;
+        low = 4;
+        k = 5;
+    }
+
+    const uint64_t blocks = n / m;
+    uint64_t counts[7] = {0};
+    uint64_t longest;
+    double chi = 0.0;
+    double expected;
+    double diff;
+
+    for (uint64_t i = 0; i < blocks; i++)
+    {
+        longest = stats_longest(src, n, i * m, i * m + m);
+        longest = longest < low ? low : (longest > low + k ? low + k : longest);
+        counts[longest - low]++;
+    }
+
+    for (uint64_t i = 0; i <= k; i++)
+    {
+        expected = (double) blocks * pi[i];
+        diff = (double) counts[i] - expected;
+        chi += diff * diff / expected;
+    }
+
+    return stats_igamc((double) k / 2.0, chi / 2.0);
+}
+
+/*******************************************************************************
+Gaussian elimination with each row in one word. A pivot is cleared from every
+later row with a mask instead of a branch, since whether a row holds the pivot
+column is a coin flip on random data.
+*/
+
+int rng_gf2_rank
+(
+    const uint64_t * const rows,
+    const int size
+)
+{
+    assert(rows != NULL && "null matrix");
+    assert(size >= 1 && size <= 64 && "invalid matrix size");
+
+    uint64_t matrix[64];
+    uint64_t pivot;
+    int rank = 0;
+
+    memcpy(matrix, rows, (size_t) size * sizeof(uint64_t));
+
+    for (int col = 0; col < size && rank < size; col++)
+    {
+        int row = rank;
+
+        while (row < size && !((matrix[row] >> col) & 1)) row++;
+        if (row == size) continue;
+
+        pivot = matrix[row];
+        matrix[row] = matrix[rank];
+        matrix[rank] = pivot;
+
+        for (int i = rank + 1; i < size; i++)
+        {
+            matrix[i] ^= pivot & (0 - ((matrix[i] >> col) & 1));
+        }
+
+        rank++;
+    }
+
+    return rank;
+}
+
+/******************************************************************************/
+
+uint64_t rng_linear_complexity
+(
+    const uint64_t * const src,
+    const uint64_t n
+)
+{
+    assert(src != NULL && "null source");
+    assert(n != 0 && "no data");
+
+    uint64_t *work = malloc((5 * ((n + 63) / 64) + 8) * sizeof(uint64_t));
+    assert(work != NULL && "malloc failure");
+
+    uint64_t complexity = stats_berlekamp(src, n, 0, n, work);
+
+    free(work);
+
+    return complexity;
+}
+
+/*******************************************************************************
+Each matrix is 1024 consecutive bits, so it takes 16 whole words with the rows in
+the 32-bit halves. The rows are the standard's rows with their columns mirrored,
+which doesn't change the rank.
+*/
+
+double rng_nist_rank
+(
+    const uint64_t * const src,
+    const uint64_t n
+)
+{
+    assert(src != NULL && "null source");
+    assert(n / (RANK_SIZE * RANK_SIZE) >= 38 && "too few samples");
+
+    const uint64_t matrices = n / (RANK_SIZE * RANK_SIZE);
+    const double total = (double) matrices;
+    uint64_t counts[3] = {0, 0, 0};
+    uint64_t rows[RANK_SIZE];
+    const uint64_t *words;
+    int rank;
+
+    for (uint64_t i = 0; i < matrices; i++)
+    {
+        words = src + i * RANK_SIZE / 2;
+
+        for (int j = 0; j < RANK_SIZE / 2; j++)
+        {
+            rows[2 * j] = words[j] & 0xFFFFFFFF;
+            rows[2 * j + 1] = words[j] >> 32;
+        }
+
+        rank = rng_gf2_rank(rows, RANK_SIZE);
+        counts[rank == RANK_SIZE ? 0 : (rank == RANK_SIZE - 1 ? 1 : 2)]++;
+    }
+
+    const double full = stats_rank_probability(RANK_SIZE, RANK_SIZE);
+    const double less = stats_rank_probability(RANK_SIZE - 1, RANK_SIZE);
+    const double pi[3] = {full, less, 1.0 - full - less};
+    double chi = 0.0;
+    double diff;
+
+    for (int i = 0; i < 3; i++)
+    {
+        diff = (double) counts[i] - total * pi[i];
+        chi += diff * diff / (total * pi[i]);
+    }
+
+    return exp(-chi / 2.0);
+}
+
+/*******************************************************************************
+Category probabilities of section 3.10 are 1/96, 1/32, 1/8, 1/2, 1/4, 1/16 and
+1/48. Each Berlekamp-Massey run is a long serial chain, so blocks are spread over
+the threads, each of which reuses one work array and keeps its own counts.
+*/
+
+double rng_nist_linear_complexity
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const uint64_t m,
+    const int threads
+)
+{
+    assert(src != NULL && "null source");
+    assert(m != 0 && "empty block");
+    assert(n >= m && "too few samples");
+    assert(threads >= 1 && "invalid thread count");
+
+    static const double pi[7] =
+    {
+        1.0 / 96.0, 1.0 / 32.0, 1.0 / 8.0, 1.0 / 2.0, 1.0 / 4.0, 1.0 / 16.0, 1.0 / 48.0
+    };
+
+    const uint64_t blocks = n / m;
+    const double sign = m % 2 == 0 ? 1.0 : -1.0;
+    const double block = (double) m;
+    const double mean = block / 2.0 + (9.0 - sign) / 36.0
+                      - (block / 3.0 + 2.0 / 9.0) / ldexp(1.0, (int) fmin(block, 1024.0));
+
+    uint64_t counts[7] = {0};
+    double chi = 0.0;
+    double diff;
+
+    #pragma omp parallel num_threads(threads)
+    {
+        uint64_t *work = malloc((5 * ((m + 63) / 64) + 8) * sizeof(uint64_t));
+        assert(work != NULL && "malloc failure");
+
+        uint64_t local[7] = {0};
+        double t;
+
+        #pragma omp for schedule(static)
+        for (uint64_t i = 0; i < blocks; i++)
+        {
+            t = (double) stats_berlekamp(src, n, i * m, m, work);
+            t = sign * (t - mean) + 2.0 / 9.0;
+
+            if (t <= -2.5) local[0]++;
+            else if (t <= -1.5) local[1]++;
+            else if (t <= -0.5) local[2]++;
+            else if (t <= 0.5) local[3]++;
+            else if (t <= 1.5) local[4]++;
+            else if (t <= 2.5) local[5]++;
+            else local[6]++;
+        }
+
+        #pragma omp critical
+        for (int i = 0; i < 7; i++) counts[i] += local[i];
+
+        free(work);
+    }
+
+    for (int i = 0; i < 7; i++)
+    {
+        diff = (double) counts[i] - (double) blocks * pi[i];
+        chi += diff * diff / ((double) blocks * pi[i]);
+    }
+
+    return stats_igamc(3.0, chi / 2.0);
+}
+
+/*******************************************************************************
+The m, m - 1 and m - 2 pattern counts come from a single count of m-bit patterns
+since every shorter pattern is the prefix of exactly two longer ones.
+*/
+
+void rng_nist_serial
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const int m,
+    double p[2]
+)
+{
+    assert(src != NULL && "null source");
+    assert(p != NULL && "null output");
+    assert(m >= 2 && m <= MAX_PATTERN && "invalid pattern length");
+    assert(n != 0 && "no data");
+
+    uint64_t *counts = malloc(sizeof(uint64_t) << m);
+    assert(counts != NULL && "malloc failure");
+
+    stats_patterns(src, n, m, counts);
+    stats_serial(counts, m, n, p);
+
+    free(counts);
+}
+
+/******************************************************************************/
+
+double rng_nist_approximate_entropy
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const int m
+)
+{
+    assert(src != NULL && "null source");
+    assert(m >= 1 && m < MAX_PATTERN && "invalid pattern length");
+    assert(n != 0 && "no data");
+
+    uint64_t *counts = malloc(sizeof(uint64_t) << (m + 1));
+    assert(counts != NULL && "malloc failure");
+
+    stats_patterns(src, n, m + 1, counts);
+
+    double apen = stats_phi(counts, m + 1, n);
+    stats_marginal(counts, m + 1);
+    apen = stats_phi(counts, m, n) - apen;
+
+    free(counts);
+
+    const double chi = 2.0 * (double) n * (log(2.0) - apen);
+
+    return stats_igamc(ldexp(1.0, m - 1), chi / 2.0);
+}
+
+/*******************************************************************************
+The partial sums are walked a byte at a time with a table holding the sum, the
+largest prefix sum and the smallest prefix sum of every byte. The forward test
+takes the largest |S_k| over k in [1, n] and the backward test the largest
+|S_n - S_k| over k in [0, n), so the walk stops one bit short of the end to keep
+both extremes.
+*/
+
+void rng_nist_cusum
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    double p[2]
+)
+{
+    assert(src != NULL && "null source");
+    assert(p != NULL && "null output");
+    assert(n != 0 && "no data");
+
+    int8_t table[256][3];
+    int64_t sum = 0;
+    int64_t high = INT64_MIN;
+    int64_t low = INT64_MAX;
+    int64_t last;
+    uint64_t i = 0;
+
+    for (int byte = 0; byte < 256; byte++)
+    {
+        int prefix = 0;
+
+        table[byte][1] = -8;
+        table[byte][2] = 8;
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+            prefix += (byte >> bit) & 1 ? 1 : -1;
+            if (prefix > table[byte][1]) table[byte][1] = (int8_t) prefix;
+            if (prefix < table[byte][2]) table[byte][2] = (int8_t) prefix;
+        }
+
+        table[byte][0] = (int8_t) prefix;
+    }
+
+    const uint8_t *bytes = (const uint8_t *) src;
+
+    for (; i + 8 < n; i += 8)
+    {
+        const int8_t *entry = table[bytes[i / 8]];
+
+        if (sum + entry[1] > high) high = sum + entry[1];
+        if (sum + entry[2] < low) low = sum + entry[2];
+        sum += entry[0];
+    }
+
+    for (; i + 1 < n; i++)
+    {
+        sum += (src[i / 64] >> (i % 64)) & 1 ? 1 : -1;
+        if (sum > high) high = sum;
+        if (sum < low) low = sum;
+    }
+
+    last = sum + ((src[i / 64] >> (i % 64)) & 1 ? 1 : -1);
+
+    const int64_t forward_high = high > last ? high : last;
+    const int64_t forward_low = low < last ? low : last;
+    const int64_t back_high = high > 0 ? high : 0;
+    const int64_t back_low = low < 0 ? low : 0;
+
+    const int64_t forward = forward_high > -forward_low ? forward_high : -forward_low;
+    const int64_t backward = last - back_low > back_high - last
+                           ? last - back_low
+                           : back_high - last;
+
+    p[0] = stats_cusum(n, (uint64_t) forward);
+    p[1] = stats_cusum(n, (uint64_t) backward);
+}
+
+/*******************************************************************************
+The serial and approximate entropy tests both need overlapping pattern counts,
+so they share one section and one count at the serial pattern length, which is
+then folded down to the approximate entropy lengths. Every other test gets a
+section of its own, except for linear complexity which takes longer than all of
+them together and is split across every thread once they are done.
+*/
+
+nist_t rng_nist
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const int threads
+)
+{
+    assert(src != NULL && "null source");
+    assert(n >= (1 << 16) && "too few samples");
+    assert(threads >= 1 && "invalid thread count");
+
+    const int bits = 63 - __builtin_clzll(n);
+    const int serial_m = bits - 3 < 16 ? bits - 3 : 16;
+    const int apen_m = bits - 6 < 10 ? bits - 6 : 10;
+    const uint64_t block = (n / 99 / 64 + 1) * 64;
+
+    nist_t nist;
+
+    #pragma omp parallel sections num_threads(threads)
+    {
+        #pragma omp section
+        {
+            uint64_t *counts = malloc(sizeof(uint64_t) << serial_m);
+            assert(counts != NULL && "malloc failure");
+
+            stats_patterns(src, n, serial_m, counts);
+            stats_serial(counts, serial_m, n, nist.serial);
+
+            for (int m = serial_m - 2; m > apen_m + 1; m--) stats_marginal(counts, m);
+
+            double apen = stats_phi(counts, apen_m + 1, n);
+            stats_marginal(counts, apen_m + 1);
+            apen = stats_phi(counts, apen_m, n) - apen;
+
+            const double chi = 2.0 * (double) n * (log(2.0) - apen);
+            nist.approximate_entropy = stats_igamc(ldexp(1.0, apen_m - 1), chi / 2.0);
+
+            free(counts);
+        }
+
+        #pragma omp section
+        nist.frequency = rng_nist_frequency(src, n);
+
+        #pragma omp section
+        nist.block_frequency = rng_nist_block_frequency(src, n, block);
+
+        #pragma omp section
+        nist.runs = rng_nist_runs(src, n);
+
+        #pragma omp section
+        nist.longest_run = rng_nist_longest_run(src, n);
+
+        #pragma omp section
+        rng_nist_cusum(src, n, nist.cusum);
+
+        #pragma omp section
+        nist.rank = rng_nist_rank(src, n);
+    }
+
+    nist.linear_complexity = rng_nist_linear_complexity
+    (
+        src, n, COMPLEXITY_BLOCK, threads
+    );
+
+    return nist;
+}
+
+/******************************************************************************/
+
+double rng_nist_min(const nist_t nist)
+{
+    double p = fmin(nist.frequency, nist.block_frequency);
+
+    p = fmin(p, fmin(nist.runs, nist.longest_run));
+    p = fmin(p, fmin(nist.rank, nist.linear_complexity));
+    p = fmin(p, fmin(nist.serial[0], nist.serial[1]));
+    p = fmin(p, nist.approximate_entropy);
+    p = fmin(p, fmin(nist.cusum[0], nist.cusum[1]));
+
+    return p;
+}
+
+/*******************************************************************************
+Every battery is independent, so they are spread over the threads with one
+battery per thread rather than splitting the tests of a battery. A single lane
+or a pair of lanes is gathered into a private buffer by its own thread. Pairs are
+numbered in row order, so pair j of lane a with b > a sits after the pairs of
+every lane before a.
+*/
+
+void rng_lanes
+(
+    const uint64_t * const src,
+    const uint64_t words,
+    const int lanes,
+    nist_t * const out,
+    const int threads
+)
+{
+    assert(src != NULL && "null source");
+    assert(out != NULL && "null output");
+    assert(lanes >= 2 && "too few lanes");
+    assert(words % (uint64_t) lanes == 0 && "partial lane");
+    assert(words / (uint64_t) lanes >= 1024 && "too few samples");
+    assert(threads >= 1 && "invalid thread count");
+
+    const uint64_t length = words / (uint64_t) lanes;
+    const int pairs = lanes * (lanes - 1) / 2;
+
+    #pragma omp parallel for num_threads(threads) schedule(dynamic)
+    for (int j = 0; j < lanes + pairs; j++)
+    {
+        uint64_t *lane = malloc(length * sizeof(uint64_t));
+        assert(lane != NULL && "malloc failure");
+
+        int a = j;
+        int b = -1;
+
+        if (j >= lanes)
+        {
+            a = 0;
+            b = j - lanes;
+
+            while (b >= lanes - 1 - a)
+            {
+                b -= lanes - 1 - a;
+                a++;
+            }
+
+            b += a + 1;
+        }
+
+        for (uint64_t i = 0; i < length; i++)
+        {
+            lane[i] = src[i * (uint64_t) lanes + (uint64_t) a];
+            if (b >= 0) lane[i] ^= src[i * (uint64_t) lanes + (uint64_t) b];
+        }
+
+        out[j] = rng_nist(lane, length * 64, 1);
+
+        free(lane);
+    }
+
+    out[lanes + pairs] = rng_nist(src, words * 64, threads);
+}
+
+/*******************************************************************************
+The histogram is kept as four interleaved sub-histograms, one for each 64-bit
+block of an AVX2 register, so that a run of equal samples increments four
+different counters rather than waiting on the previous increment of a single
+counter. See stats_bin.
+*/
+
+void rng_histogram
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    uint64_t * const counts,
+    const uint64_t bins
+)
+{
+    assert(src != NULL && "null source");
+    assert(counts != NULL && "null counts");
+    assert(bins != 0 && "no bins");
+
+    uint64_t *sub = calloc(4 * bins, sizeof(uint64_t));
+    assert(sub != NULL && "malloc failure");
+
+    stats_bin(src, n, sub, bins);
+    stats_fold(sub, counts, bins);
+
+    free(sub);
+}
+
+/*******************************************************************************
+The samples are split into one share per thread rather than per OpenMP thread
+number, so share t always uses generator t and the first n % threads shares draw
+one extra sample. A share is drawn into a small buffer which is then binned, and
+the sub-histograms of the shares are merged at the end.
+*/
+
+bool rng_sample_histogram
+(
+    const sampler_t sample,
+    const void * const ctx,
+    const uint64_t seed,
+    const uint64_t n,
+    uint64_t * const counts,
+    const uint64_t bins,
+    const int threads
+)
+{
+    assert(sample != NULL && "null sampler");
+    assert(counts != NULL && "null counts");
+    assert(bins != 0 && "no bins");
+    assert(threads >= 1 && "invalid thread count");
+
+    random_t *rng = malloc((size_t) threads * sizeof(random_t));
+    assert(rng != NULL && "malloc failure");
+
+    if (!rng_init_many(seed, rng, (size_t) threads))
+    {
+        free(rng);
+        return false;
+    }
+
+    const uint64_t share = n / (uint64_t) threads;
+    const uint64_t extra = n % (uint64_t) threads;
+
+    #pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for (int t = 0; t < threads; t++)
+    {
+        uint64_t buffer[SAMPLE_BUFFER];
+        uint64_t *sub = calloc(4 * bins, sizeof(uint64_t));
+        assert(sub != NULL && "malloc failure");
+
+        uint64_t remaining = share + ((uint64_t) t < extra ? 1 : 0);
+        uint64_t len;
+
+        while (remaining > 0)
+        {
+            len = remaining < SAMPLE_BUFFER ? remaining : SAMPLE_BUFFER;
+
+            for (uint64_t i = 0; i < len; i++) buffer[i] = sample(rng + t, ctx);
+
+            stats_bin(buffer, len, sub, bins);
+            remaining -= len;
+        }
+
+        #pragma omp critical
+        stats_fold(sub, counts, bins);
+
+        free(sub);
+    }
+
+    free(rng);
+
+    return true;
+}
+
+/*******************************************************************************
+Bins of zero probability are skipped since their expected count is zero, unless
+a sample landed in one, which is impossible under the distribution.
+*/
+
+fit_t rng_chi_square
+(
+    const uint64_t * const counts,
+    const double * const probability,
+    const uint64_t bins
+)
+{
+    assert(counts != NULL && "null counts");
+    assert(probability != NULL && "null probability");
+
+    uint64_t total = 0;
+    uint64_t cells = 0;
+    bool impossible = false;
+    double chi = 0.0;
+    double expected;
+    double diff;
+
+    for (uint64_t i = 0; i < bins; i++) total += counts[i];
+
+    assert(total != 0 && "no samples");
+
+    for (uint64_t i = 0; i < bins; i++)
+    {
+        expected = (double) total * probability[i];
+
+        if (expected > 0.0)
+        {
+            diff = (double) counts[i] - expected;
+            chi += diff * diff / expected;
+            cells++;
+        }
+        else if (counts[i] != 0) impossible = true;
+    }
+
+    assert(cells >= 2 && "too few bins");
+
+    if (impossible) return (fit_t) {.statistic = INFINITY, .p = 0.0};
+
+    return (fit_t)
+    {
+        .statistic = chi,
+        .p = stats_igamc((double) (cells - 1) / 2.0, chi / 2.0)
+    };
+}
+
+/*******************************************************************************
+The empirical distribution function of a histogram only steps at the bins, so
+the largest distance is found at the top of one of them. The p-value uses the
+effective sample size correction of Stephens, (sqrt(n) + 0.12 + 0.11 / sqrt(n)).
+*/
+
+fit_t rng_ks
+(
+    const uint64_t * const counts,
+    const double * const probability,
+    const uint64_t bins
+)
+{
+    assert(counts != NULL && "null counts");
+    assert(probability != NULL && "null probability");
+    assert(bins != 0 && "no bins");
+
+    uint64_t total = 0;
+    uint64_t seen = 0;
+    double cdf = 0.0;
+    double distance = 0.0;
+
+    for (uint64_t i = 0; i < bins; i++) total += counts[i];
+
+    assert(total != 0 && "no samples");
+
+    for (uint64_t i = 0; i < bins; i++)
+    {
+        seen += counts[i];
+        cdf += probability[i];
+        distance = fmax(distance, fabs((double) seen / (double) total - cdf));
+    }
+
+    const double root = sqrt((double) total);
+
+    return (fit_t)
+    {
+        .statistic = distance,
+        .p = stats_kolmogorov((root + 0.12 + 0.11 / root) * distance)
+    };
+}
+
+/*******************************************************************************
+Number of ones in bits [begin, end). The first word is counted whole and the
+bits before begin are taken back out at the end.
+*/
+
+static uint64_t stats_popcount
+(
+    const uint64_t *src,
+    uint64_t begin,
+    uint64_t end
+)
+{
+    __m256i total = _mm256_setzero_si256();
+    uint64_t i = begin / 64;
+    uint64_t ones;
+
+    for (; (i + 4) * 64 <= end; i += 4)
+    {
+        total = _mm256_add_epi64
+        (
+            total,
+            u64_bitarray_popcount256(_mm256_loadu_si256((const __m256i *) (src + i)))
+        );
+    }
+
+    ones = (uint64_t) _mm256_extract_epi64(total, 0)
+         + (uint64_t) _mm256_extract_epi64(total, 1)
+         + (uint64_t) _mm256_extract_epi64(total, 2)
+         + (uint64_t) _mm256_extract_epi64(total, 3);
+
+    for (; (i + 1) * 64 <= end; i++)
+    {
+        ones += (uint64_t) __builtin_popcountll(src[i]);
+    }
+
+    if (i * 64 < end)
+    {
+        ones += (uint64_t) __builtin_popcountll(src[i] & (~0ULL >> (64 - end % 64)));
+    }
+
+    if (begin % 64 != 0)
+    {
+        ones -= (uint64_t) __builtin_popcountll(src[begin / 64] & ~(~0ULL << begin % 64));
+    }
+
+    return ones;
+}
+
+/*******************************************************************************
+Number of positions i in [begin, end) with i + 1 < n such that bits i and i + 1
+are both set, begin is a multiple of 64. Bit i of x & ((x >> 1) | (y << 63)) is
+exactly that test when y is the word after x.
+*/
+
+static uint64_t stats_pairs
+(
+    const uint64_t *src,
+    uint64_t n,
+    uint64_t begin,
+    uint64_t end
+)
+{
+    const uint64_t limit = end < n - 1 ? end : n - 1;
+    __m256i total = _mm256_setzero_si256();
+    __m256i x;
+    __m256i y;
+    uint64_t i = begin / 64;
+    uint64_t pairs;
+    uint64_t next;
+
+    for (; (i + 4) * 64 <= limit; i += 4)
+    {
+        x = _mm256_loadu_si256((const __m256i *) (src + i));
+        y = _mm256_loadu_si256((const __m256i *) (src + i + 1));
+        y = _mm256_or_si256(_mm256_srli_epi64(x, 1), _mm256_slli_epi64(y, 63));
+        total = _mm256_add_epi64(total, u64_bitarray_popcount256(_mm256_and_si256(x, y)));
+    }
+
+    pairs = (uint64_t) _mm256_extract_epi64(total, 0)
+          + (uint64_t) _mm256_extract_epi64(total, 1)
+          + (uint64_t) _mm256_extract_epi64(total, 2)
+          + (uint64_t) _mm256_extract_epi64(total, 3);
+
+    for (; i * 64 < limit; i++)
+    {
+        next = (i + 1) * 64 < n ? src[i + 1] : 0;
+        next = src[i] & ((src[i] >> 1) | (next << 63));
+
+        if ((i + 1) * 64 > limit) next &= ~0ULL >> (64 - limit % 64);
+
+        pairs += (uint64_t) __builtin_popcountll(next);
+    }
+
+    return pairs;
+}
+
+/*******************************************************************************
+Entry [o][x] describes the collision parse of one byte when the parse starts at
+bit o of the byte and x holds the byte plus the two bits after it, which is the
+furthest a triple starting inside the byte can reach. The low 3 bits count the
+pairs, the next 2 bits count the triples and the top bits hold the offset into
+the next byte at which the parse continues.
+*/
+
+static void stats_collision_table
+(
+    uint8_t table[3][1024]
+)
+{
+    uint64_t pos;
+    uint64_t pairs;
+    uint64_t triples;
+
+    for (uint64_t o = 0; o < 3; o++)
+    {
+        for (uint64_t x = 0; x < 1024; x++)
+        {
+            pos = o;
+            pairs = 0;
+            triples = 0;
+
+            while (pos < 8)
+            {
+                if (((x >> pos) & 1) == ((x >> (pos + 1)) & 1))
+                {
+                    pairs++;
+                    pos += 2;
+                }
+                else
+                {
+                    triples++;
+                    pos += 3;
+                }
+            }
+
+            table[o][x] = (uint8_t) (pairs | triples << 3 | (pos - 8) << 5);
+        }
+    }
+}
+
+/*******************************************************************************
+Continue the collision parse from bit pos until it reaches or passes bit end and
+return the position at which it stopped, or n if the stream ran out before the
+next collision. Whole bytes go through the table, the edges are done bit by bit.
+*/
+
+static uint64_t stats_collision_walk
+(
+    const uint64_t *src,
+    uint64_t n,
+    uint64_t pos,
+    uint64_t end,
+    uint8_t table[3][1024],
+    uint64_t counts[2]
+)
+{
+    uint16_t window;
+    uint64_t base;
+    uint8_t step;
+
+    while (pos < end)
+    {
+        base = pos - pos % 8;
+
+        if (pos % 8 < 3 && base + 8 <= end && base + 10 <= n)
+        {
+            memcpy(&window, (const uint8_t *) src + base / 8, sizeof(window));
+            step = table[pos % 8][window & 0x3FF];
+
+            counts[0] += step & 7;
+            counts[1] += (step >> 3) & 3;
+            pos = base + 8 + (uint64_t) (step >> 5);
+        }
+        else if (pos + 1 >= n)
+        {
+            return n;
+        }
+        else if (!u64_bitarray_test(src, pos) != !u64_bitarray_test(src, pos + 1))
+        {
+            if (pos + 2 >= n) return n;
+
+            counts[1]++;
+            pos += 3;
+        }
+        else
+        {
+            counts[0]++;
+            pos += 2;
+        }
+    }
+
+    return pos;
+}
+
+/*******************************************************************************
+Base 2 logarithms of the distances short enough to be looked up.
+*/
+
+static void stats_log_table
+(
+    double *table
+)
+{
+    table[0] = 0.0;
+
+    for (uint64_t i = 1; i < LOG_TABLE; i++)
+    {
+        table[i] = log2((double) i);
+    }
+}
+
+/*******************************************************************************
+Walk the 6-bit blocks [begin, end) and record the first and last occurrence of
+each value. Distances between occurrences inside the chunk are summed here if the
+later block is past the dictionary, the first occurrences are left to the merge.
+*/
+
+static void stats_compression_walk
+(
+    const uint64_t *src,
+    uint64_t begin,
+    uint64_t end,
+    const double *log_table,
+    tally_t *tally
+)
+{
+    uint64_t pos;
+    uint64_t value;
+    uint64_t distance;
+    double log_distance;
+
+    memset(tally->first, 0xFF, sizeof(tally->first));
+    memset(tally->last, 0xFF, sizeof(tally->last));
+    tally->sum = 0.0;
+    tally->square = 0.0;
+
+    for (uint64_t b = begin; b < end; b++)
+    {
+        pos = b * BLOCK_BITS;
+        value = src[pos / 64] >> (pos % 64);
+
+        if (pos % 64 > 64 - BLOCK_BITS)
+        {
+            value |= src[pos / 64 + 1] << (64 - pos % 64);
+        }
+
+        value &= BLOCK_VALUES - 1;
+
+        if (tally->last[value] == NONE)
+        {
+            tally->first[value] = b;
+        }
+        else if (b >= DICTIONARY)
+        {
+            distance = b - tally->last[value];
+
+            log_distance = distance < LOG_TABLE ? log_table[distance]
+                                                : log2((double) distance);
+
+            tally->sum += log_distance;
+            tally->square += log_distance * log_distance;
+        }
+
+        tally->last[value] = b;
+    }
+}
+
+/*******************************************************************************
+Upper bound of the 99% confidence interval on the more common bit.
+*/
+
+static double stats_mcv
+(
+    uint64_t n,
+    uint64_t ones
+)
+{
+    const double total = (double) n;
+    const double p = (double) (ones > n - ones ? ones : n - ones) / total;
+
+    double upper = p + Z_99 * sqrt(p * (1.0 - p) / (total - 1.0));
+
+    return -log2(fmin(1.0, upper));
+}
+
+/*******************************************************************************
+For two symbols the expected collision time is 2 + 2pq, so the lower bound of
+the 99% interval on the mean inverts directly to the probability of the more
+common bit instead of through the bisection search of the general estimator.
+*/
+
+static double stats_collision
+(
+    const uint64_t counts[2]
+)
+{
+    const double pairs = (double) counts[0];
+    const double triples = (double) counts[1];
+    const double total = pairs + triples;
+
+    const double mean = (2.0 * pairs + 3.0 * triples) / total;
+    const double square = 4.0 * pairs + 9.0 * triples;
+    const double var = (square - total * mean * mean) / (total - 1.0);
+    const double lower = mean - Z_99 * sqrt(fmax(var, 0.0)) / sqrt(total);
+
+    if (lower >= 2.5) return 1.0;
+    if (lower <= 2.0) return 0.0;
+
+    return -log2(0.5 + sqrt(0.25 - (lower - 2.0) / 2.0));
+}
+
+/*******************************************************************************
+Probability of the most likely 128-bit sequence by dynamic programming over the
+two states, which is exact where the standard enumerates six candidate paths.
+*/
+
+static double stats_markov
+(
+    const uint64_t *src,
+    uint64_t n,
+    uint64_t ones,
+    uint64_t pairs
+)
+{
+    const uint64_t head = ones - ((src[(n - 1) / 64] >> ((n - 1) % 64)) & 1);
+    const uint64_t tail = ones - (src[0] & 1);
+
+    const double from[2] = {(double) (n - 1 - head), (double) head};
+
+    const double count[2][2] =
+    {
+        {from[0] - (double) (tail - pairs), (double) (tail - pairs)},
+        {(double) (head - pairs), (double) pairs}
+    };
+
+    double path[2] =
+    {
+        log2((double) (n - ones) / (double) n),
+        log2((double) ones / (double) n)
+    };
+
+    double next[2];
+    double edge;
+
+    for (size_t step = 1; step < 128; step++)
+    {
+        for (size_t j = 0; j < 2; j++)
+        {
+            next[j] = -INFINITY;
+
+            for (size_t i = 0; i < 2; i++)
+            {
+                if (count[i][j] == 0.0) continue;
+
+                edge = path[i] + log2(count[i][j] / from[i]);
+                if (edge > next[j]) next[j] = edge;
+            }
+        }
+
+        path[0] = next[0];
+        path[1] = next[1];
+    }
+
+    return fmin(1.0, -fmax(path[0], path[1]) / 128.0);
+}
+
+/*******************************************************************************
+Merge the chunk tallies in order, filling in the distance of the first occurrence
+of each value in a chunk from the dictionary of the chunks before it. Then solve
+E(p) = G(p) + 63 G(q) against the lower bound of the mean by bisection.
+*/
+
+static double stats_compression
+(
+    const tally_t *tallies,
+    uint64_t chunks,
+    uint64_t n
+)
+{
+    const uint64_t blocks = n / BLOCK_BITS;
+    const double tested = (double) (blocks - DICTIONARY);
+
+    uint64_t last[BLOCK_VALUES];
+    uint64_t first;
+    uint64_t distance;
+    double sum = 0.0;
+    double square = 0.0;
+    double log_distance;
+
+    memset(last, 0xFF, sizeof(last));
+
+    for (uint64_t c = 0; c < chunks; c++)
+    {
+        for (uint64_t v = 0; v < BLOCK_VALUES; v++)
+        {
+            first = tallies[c].first[v];
+
+            if (first == NONE) continue;
+
+            if (first >= DICTIONARY)
+            {
+                distance = last[v] == NONE ? first + 1 : first - last[v];
+                log_distance = log2((double) distance);
+                sum += log_distance;
+                square += log_distance * log_distance;
+            }
+
+            last[v] = tallies[c].last[v];
+        }
+
+        sum += tallies[c].sum;
+        square += tallies[c].square;
+    }
+
+    const double b = (double) BLOCK_BITS;
+    const double scale = 0.7 - 0.8 / b 
+                       + (4.0 + 32.0 / b) * pow(tested, -3.0 / b) / 15.0;
+    const double mean = sum / tested;
+    const double var = (square - tested * mean * mean) / (tested - 1.0);
+    const double lower = mean - Z_99 * scale * sqrt(fmax(var, 0.0)) / sqrt(tested);
+
+    double low = 1.0 / BLOCK_VALUES;
+    double high = 1.0;
+    double mid;
+
+    if (lower >= BLOCK_VALUES * stats_maurer_g(low, blocks)) return 1.0;
+
+    for (int i = 0; i < 64 && high - low > 1e-12; i++)
+    {
+        mid = (low + high) / 2.0;
+
+        const double q = (1.0 - mid) / (BLOCK_VALUES - 1);
+        const double expected = stats_maurer_g(mid, blocks)
+                              + (BLOCK_VALUES - 1) * stats_maurer_g(q, blocks);
+
+        if (expected > lower) low = mid;
+        else high = mid;
+    }
+
+    return -log2(high) / b;
+}
+
+/*******************************************************************************
+G(z) of SP 800-90B 6.3.4. Swapping the order of the double sum over t and u
+leaves a single geometric series in (1 - z)^(u - 1), in which log2(u) is weighted
+by the number of tested blocks t > u. The series is cut off once its tail can no
+longer change the sum.
+*/
+
+static double stats_maurer_g
+(
+    double z,
+    uint64_t blocks
+)
+{
+    const double tested = (double) (blocks - DICTIONARY);
+    const double tail = log2((double) blocks) * (z * (double) blocks + 1.0);
+
+    double sum = 0.0;
+    double power = 1.0;
+    double log_u;
+    double count;
+
+    if (z <= 0.0) return 0.0;
+
+    for (uint64_t u = 1; u <= blocks; u++)
+    {
+        log_u = log2((double) u);
+
+        count = (double) (blocks - (u > DICTIONARY ? u : DICTIONARY));
+        sum += log_u * z * z * power * count;
+        if (u > DICTIONARY) sum += log_u * z * power;
+
+        power *= 1.0 - z;
+
+        if (u > DICTIONARY && power * tail < 1e-15 * sum) break;
+    }
+
+    return sum / tested;
+}
+
+/*******************************************************************************
+Longest run of ones in bits [begin, end), read 64 bits at a time. A run that
+reaches the top of a word carries into the trailing ones of the next, and the
+longest run inside a word is the number of x &= x >> 1 steps that empty it.
+*/
+
+static uint64_t stats_longest
+(
+    const uint64_t *src,
+    uint64_t n,
+    uint64_t begin,
+    uint64_t end
+)
+{
+    uint64_t longest = 0;
+    uint64_t run = 0;
+    uint64_t len;
+    uint64_t x;
+    uint64_t y;
+    uint64_t steps;
+
+    for (uint64_t pos = begin; pos < end; pos += 64)
+    {
+        len = end - pos < 64 ? end - pos : 64;
+        x = u64_bitarray_load(src, pos, n) & (~0ULL >> (64 - len));
+
+        if (x == ~0ULL >> (64 - len))
+        {
+            run += len;
+            continue;
+        }
+
+        y = (uint64_t) __builtin_ctzll(~x) + run;
+        if (y > longest) longest = y;
+
+        for (y = x, steps = 0; y != 0; steps++) y &= y >> 1;
+        if (steps > longest) longest = steps;
+
+        run = (uint64_t) __builtin_clzll(~(x << (64 - len)));
+    }
+
+    return longest > run ? longest : run;
+}
+
+/*******************************************************************************
+Counts of the n overlapping m-bit patterns of the stream extended cyclically by
+its first m - 1 bits, with the first bit of a pattern in its lowest bit. Every
+pattern that starts in a whole word other than the last one is a funnel shift of
+that word and the next, the rest are read through the cyclic load.
+*/
+
+static void stats_patterns
+(
+    const uint64_t *src,
+    uint64_t n,
+    int m,
+    uint64_t *counts
+)
+{
+    const uint64_t mask = ~(~0ULL << m);
+    const uint64_t fast = n / 64 > 0 ? n / 64 - 1 : 0;
+    uint64_t lo;
+    uint64_t hi;
+
+    memset(counts, 0, sizeof(uint64_t) << m);
+
+    for (uint64_t w = 0; w < fast; w++)
+    {
+        lo = src[w];
+        hi = src[w + 1];
+
+        counts[lo & mask]++;
+
+        for (int b = 1; b < 64; b++)
+        {
+            counts[((lo >> b) | (hi << (64 - b))) & mask]++;
+        }
+    }
+
+    for (uint64_t pos = fast * 64; pos < n; pos++)
+    {
+        counts[u64_bitarray_load_cyclic(src, pos, n) & mask]++;
+    }
+}
+
+/*******************************************************************************
+Fold the counts of m-bit patterns into the counts of their (m - 1)-bit prefixes,
+which end up in the first half of the array.
+*/
+
+static void stats_marginal
+(
+    uint64_t *counts,
+    int m
+)
+{
+    const uint64_t half = 1ULL << (m - 1);
+
+    for (uint64_t v = 0; v < half; v++) counts[v] += counts[v + half];
+}
+
+/*******************************************************************************
+psi^2_m of SP 800-22 2.11.
+*/
+
+static double stats_psi2
+(
+    const uint64_t *counts,
+    int m,
+    uint64_t n
+)
+{
+    double sum = 0.0;
+
+    for (uint64_t v = 0; v < 1ULL << m; v++)
+    {
+        sum += (double) counts[v] * (double) counts[v];
+    }
+
+    return ldexp(sum, m) / (double) n - (double) n;
+}
+
+/*******************************************************************************
+phi^m of SP 800-22 2.12.
+*/
+
+static double stats_phi
+(
+    const uint64_t *counts,
+    int m,
+    uint64_t n
+)
+{
+    double sum = 0.0;
+    double pi;
+
+    for (uint64_t v = 0; v < 1ULL << m; v++)
+    {
+        if (counts[v] == 0) continue;
+
+        pi = (double) counts[v] / (double) n;
+        sum += pi * log(pi);
+    }
+
+    return sum;
+}
+
+/*******************************************************************************
+Both serial p-values from the m-bit pattern counts, which are left folded down
+to the (m - 2)-bit counts. psi^2_0 is zero.
+*/
+
+static void stats_serial
+(
+    uint64_t *counts,
+    int m,
+    uint64_t n,
+    double p[2]
+)
+{
+    const double psi_m = stats_psi2(counts, m, n);
+    stats_marginal(counts, m);
+    const double psi_1 = stats_psi2(counts, m - 1, n);
+    stats_marginal(counts, m - 1);
+    const double psi_2 = m > 2 ? stats_psi2(counts, m - 2, n) : 0.0;
+
+    p[0] = stats_igamc(ldexp(1.0, m - 2), (psi_m - psi_1) / 2.0);
+    p[1] = stats_igamc(ldexp(1.0, m - 3), (psi_m - 2.0 * psi_1 + psi_2) / 2.0);
+}
+
+/*******************************************************************************
+Berlekamp-Massey over bits [begin, begin + m) of the stream. The connection
+polynomials C and B are stored mirrored, with c_i at bit d - i where d is the
+first multiple of 64 at or above m, and the block is copied in after d zero bits.
+The discrepancy at step k is then the parity of C AND-ed with the copy read from
+bit k, and the update C += x^(k - j) B is a right shift of B by k - j bits, where
+j is the last step at which L changed, or -1 before the first change. Since the
+degree of C never exceeds L, both loops only visit the words of live terms. The
+work array holds 5 * ceil(m / 64) + 8 words.
+*/
+
+static uint64_t stats_berlekamp
+(
+    const uint64_t *src,
+    uint64_t n,
+    uint64_t begin,
+    uint64_t m,
+    uint64_t *work
+)
+{
+    const uint64_t top = (m + 63) / 64;
+    const uint64_t d = 64 * top;
+
+    uint64_t *c = work;
+    uint64_t *b = c + top + 1;
+    uint64_t *t = b + top + 1;
+    uint64_t *copy = t + top + 1;
+
+    uint64_t length = 0;
+    uint64_t b_length = 0;
+    uint64_t last = 0;
+    uint64_t shift;
+    uint64_t parity;
+    uint64_t lo;
+    uint64_t x;
+
+    memset(work, 0, (3 * top + 3) * sizeof(uint64_t));
+    memset(copy, 0, (2 * top + 5) * sizeof(uint64_t));
+
+    for (uint64_t i = 0; i < top; i++)
+    {
+        x = u64_bitarray_load(src, begin + 64 * i, n);
+        if (m - 64 * i < 64) x &= ~0ULL >> (64 - (m - 64 * i));
+        copy[top + i] = x;
+    }
+
+    c[top] = 1;
+    b[top] = 1;
+
+    for (uint64_t k = 0; k < m; k++)
+    {
+        const uint64_t q = k / 64;
+        const uint64_t r = k % 64;
+
+        lo = (d - length) / 64;
+        parity = 0;
+
+        if (r == 0)
+        {
+            for (uint64_t w = lo; w <= top; w++) parity ^= c[w] & copy[w + q];
+        }
+        else
+        {
+            for (uint64_t w = lo; w <= top; w++)
+            {
+                parity ^= c[w] & ((copy[w + q] >> r) | (copy[w + q + 1] << (64 - r)));
+            }
+        }
+
+        if (__builtin_parityll(parity) == 0) continue;
+
+        shift = k + 1 - last;
+
+        if (2 * length <= k) memcpy(t + lo, c + lo, (top + 1 - lo) * sizeof(uint64_t));
+
+        for (uint64_t w = (d - b_length - shift) / 64; w <= (d - shift) / 64; w++)
+        {
+            x = b[w + shift / 64] >> (shift % 64);
+
+            if (shift % 64 != 0 && w + shift / 64 < top)
+            {
+                x |= b[w + shift / 64 + 1] << (64 - shift % 64);
+            }
+
+            c[w] ^= x;
+        }
+
+        if (2 * length <= k)
+        {
+            memcpy(b, t, (top + 1) * sizeof(uint64_t));
+            b_length = length;
+            length = k + 1 - length;
+            last = k + 1;
+        }
+    }
+
+    return length;
+}
+
+/*******************************************************************************
+Probability that a random size x size matrix over GF(2) has the given rank, from
+section 3.5 of the standard.
+*/
+
+static double stats_rank_probability
+(
+    int rank,
+    int size
+)
+{
+    double p = ldexp(1.0, rank * (2 * size - rank) - size * size);
+
+    for (int i = 0; i < rank; i++)
+    {
+        p *= (1.0 - ldexp(1.0, i - size)) * (1.0 - ldexp(1.0, i - size));
+        p /= 1.0 - ldexp(1.0, i - rank);
+    }
+
+    return p;
+}
+
+/*******************************************************************************
+p-value of the cumulative sums test for the largest excursion z, with the sums
+over k bounded by truncation as in the reference implementation.
+*/
+
+static double stats_cusum
+(
+    uint64_t n,
+    uint64_t z
+)
+{
+    const double total = (double) n;
+    const double root = sqrt(total);
+    const double excursion = (double) z;
+    double sum = 1.0;
+
+    int64_t start = (int64_t) ((-total / excursion + 1.0) / 4.0);
+    int64_t stop = (int64_t) ((total / excursion - 1.0) / 4.0);
+
+    for (int64_t k = start; k <= stop; k++)
+    {
+        sum -= 0.5 * erfc(-(double) (4 * k + 1) * excursion / root / sqrt(2.0));
+        sum += 0.5 * erfc(-(double) (4 * k - 1) * excursion / root / sqrt(2.0));
+    }
+
+    start = (int64_t) ((-total / excursion - 3.0) / 4.0);
+
+    for (int64_t k = start; k <= stop; k++)
+    {
+        sum += 0.5 * erfc(-(double) (4 * k + 3) * excursion / root / sqrt(2.0));
+        sum -= 0.5 * erfc(-(double) (4 * k + 1) * excursion / root / sqrt(2.0));
+    }
+
+    return fmin(1.0, fmax(0.0, sum));
+}
+
+/*******************************************************************************
+Regularized upper incomplete gamma function Q(a, x). Below x = a + 1 the series
+for P(a, x) converges quickly and Q = 1 - P, above it the continued fraction for
+Q is evaluated directly with the modified Lentz method.
+*/
+
+static double stats_igamc
+(
+    double a,
+    double x
+)
+{
+    const double tiny = 1e-300;
+
+    if (x <= 0.0) return 1.0;
+
+    const double front = exp(a * log(x) - x - lgamma(a));
+
+    if (x < a + 1.0)
+    {
+        double term = 1.0 / a;
+        double sum = term;
+
+        for (int i = 1; i < IGAM_LIMIT; i++)
+        {
+            term *= x / (a + i);
+            sum += term;
+
+            if (term < sum * IGAM_EPSILON) break;
+        }
+
+        return fmax(0.0, 1.0 - sum * front);
+    }
+
+    double b = x + 1.0 - a;
+    double c = 1.0 / tiny;
+    double d = 1.0 / b;
+    double h = d;
+    double an;
+    double delta;
+
+    for (int i = 1; i < IGAM_LIMIT; i++)
+    {
+        an = -i * (i - a);
+        b += 2.0;
+
+        d = an * d + b;
+        if (fabs(d) < tiny) d = tiny;
+
+        c = b + an / c;
+        if (fabs(c) < tiny) c = tiny;
+
+        d = 1.0 / d;
+        delta = d * c;
+        h *= delta;
+
+        if (fabs(delta - 1.0) < IGAM_EPSILON) break;
+    }
+
+    return fmin(1.0, h * front);
+}
+
+/*******************************************************************************
+Bin four samples at a time. Samples above the last bin are clamped with an
+unsigned compare, which AVX2 lacks, so both sides are offset by 2^63 first and
+compared as signed. Each clamped bin is scaled by 4 and offset by its block, and
+the four counters are incremented from a store of the indices since AVX2 has no
+scatter. Sub-histogram j of bin i sits at sub[4 * i + j].
+*/
+
+static void stats_bin
+(
+    const uint64_t *src,
+    uint64_t n,
+    uint64_t *sub,
+    uint64_t bins
+)
+{
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i last = _mm256_set1_epi64x((int64_t) (bins - 1));
+    const __m256i limit = _mm256_xor_si256(last, sign);
+    const __m256i block = _mm256_setr_epi64x(0, 1, 2, 3);
+    __m256i x;
+    __m256i over;
+    uint64_t index[4];
+    uint64_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        x = _mm256_loadu_si256((const __m256i *) (src + i));
+        over = _mm256_cmpgt_epi64(_mm256_xor_si256(x, sign), limit);
+        x = _mm256_blendv_epi8(x, last, over);
+        x = _mm256_add_epi64(_mm256_slli_epi64(x, 2), block);
+
+        _mm256_storeu_si256((__m256i *) index, x);
+
+        sub[index[0]]++;
+        sub[index[1]]++;
+        sub[index[2]]++;
+        sub[index[3]]++;
+    }
+
+    for (; i < n; i++) sub[4 * (src[i] < bins ? src[i] : bins - 1)]++;
+}
+
+/*******************************************************************************
+Add the four sub-histograms of stats_bin to a histogram.
+*/
+
+static void stats_fold
+(
+    const uint64_t *sub,
+    uint64_t *counts,
+    uint64_t bins
+)
+{
+    for (uint64_t i = 0; i < bins; i++)
+    {
+        counts[i] += sub[4 * i] + sub[4 * i + 1] + sub[4 * i + 2] + sub[4 * i + 3];
+    }
+}
+
+/*******************************************************************************
+Survival function Q(lambda) of the Kolmogorov distribution. The alternating
+series 2 sum (-1)^(k - 1) exp(-2 k^2 lambda^2) converges in four terms above
+lambda = 1.18, below it the dual theta series for 1 - Q does. Under lambda = 0.2
+Q is 1 to double precision.
+*/
+
+static double stats_kolmogorov
+(
+    double lambda
+)
+{
+    double sum = 0.0;
+    double k;
+
+    if (lambda < 0.2) return 1.0;
+
+    if (lambda < 1.18)
+    {
+        for (int j = 1; j <= 4; j++)
+        {
+            k = (double) (2 * j - 1);
+            sum += exp(-k * k * KS_PI * KS_PI / (8.0 * lambda * lambda));
+        }
+
+        return fmin(1.0, fmax(0.0, 1.0 - sqrt(2.0 * KS_PI) / lambda * sum));
+    }
+
+    for (int j = 1; j <= 4; j++)
+    {
+        k = (double) j;
+        sum += (j % 2 == 1 ? 2.0 : -2.0) * exp(-2.0 * k * k * lambda * lambda);
+    }
+
+    return fmin(1.0, fmax(0.0, sum));
+}
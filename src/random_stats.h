@@ -0,0 +1,401 @@
+/*
+* NAME: Copyright (c) 2020, Biren Patel
+* LISC: MIT License
+* DESC: Statistical tests and entropy estimates on bitarrays, and goodness of fit
+* tests for samplers
+*/
+
+#ifndef STATS_RANDOM_H
+#define STATS_RANDOM_H
+
+#include "random_sisd.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*******************************************************************************
+* NAME: entropy_t
+* DESC: min-entropy per bit from each of the SP 800-90B estimators
+* @ mcv : most common value estimate, section 6.3.1
+* @ collision : collision estimate, section 6.3.2
+* @ markov : markov estimate, section 6.3.3
+* @ compression : compression estimate, section 6.3.4
+* @ min : smallest of the four estimates
+*******************************************************************************/
+typedef struct
+{
+    double mcv;
+    double collision;
+    double markov;
+    double compression;
+    double min;
+} entropy_t;
+
+/*******************************************************************************
+* NAME: nist_t
+* DESC: p-values of the SP 800-22 battery, see rng_nist
+* @ frequency : frequency (monobit) test, section 2.1
+* @ block_frequency : frequency test within a block, section 2.2
+* @ runs : runs test, section 2.3
+* @ longest_run : longest run of ones in a block, section 2.4
+* @ rank : binary matrix rank test on 32 x 32 matrices, section 2.5
+* @ linear_complexity : linear complexity test on 500-bit blocks, section 2.10
+* @ serial : the two serial test p-values, section 2.11
+* @ approximate_entropy : approximate entropy test, section 2.12
+* @ cusum : forward and backward cumulative sums tests, section 2.13
+*******************************************************************************/
+typedef struct
+{
+    double frequency;
+    double block_frequency;
+    double runs;
+    double longest_run;
+    double rank;
+    double linear_complexity;
+    double serial[2];
+    double approximate_entropy;
+    double cusum[2];
+} nist_t;
+
+/*******************************************************************************
+* NAME: fit_t
+* DESC: result of a goodness of fit test, see rng_chi_square and rng_ks
+* @ statistic : chi-square statistic or Kolmogorov-Smirnov distance
+* @ p : p-value of the statistic
+*******************************************************************************/
+typedef struct
+{
+    double statistic;
+    double p;
+} fit_t;
+
+/*******************************************************************************
+* NAME: sampler_t
+* DESC: sampler under test for rng_sample_histogram, for example a wrapper which
+*       returns rng_bino(rng, 20, 1, 2) or the popcount of rng_bias(rng, 3, 3)
+* OUTP: one sample
+* @ rng : generator owned by the calling thread
+* @ ctx : parameters of the sampler, shared by all threads
+*******************************************************************************/
+typedef uint64_t (*sampler_t)(random_t * const rng, const void * const ctx);
+
+/*******************************************************************************
+* NAME: rng_entropy_mcv
+* DESC: most common value estimate from the upper 99% bound on the probability
+*       of the more frequent bit
+* OUTP: min-entropy per bit in [0, 1]
+* @ src : binary bit stream of length n bits
+* @ n : at least 2
+*******************************************************************************/
+double rng_entropy_mcv(const uint64_t * const src, const uint64_t n);
+
+/*******************************************************************************
+* NAME: rng_entropy_collision
+* DESC: collision estimate from the mean number of bits until a repeated value
+* OUTP: min-entropy per bit in [0, 1]
+* @ src : binary bit stream of length n bits
+* @ n : at least 6 so that two collisions are seen
+*******************************************************************************/
+double rng_entropy_collision(const uint64_t * const src, const uint64_t n);
+
+/*******************************************************************************
+* NAME: rng_entropy_markov
+* DESC: markov estimate from the most likely 128-bit sequence under the first
+*       order transition probabilities of the stream
+* OUTP: min-entropy per bit in [0, 1]
+* @ src : binary bit stream of length n bits
+* @ n : at least 2
+*******************************************************************************/
+double rng_entropy_markov(const uint64_t * const src, const uint64_t n);
+
+/*******************************************************************************
+* NAME: rng_entropy_compression
+* DESC: compression estimate from Maurer's universal statistic on 6-bit blocks
+*       with a dictionary of 1000 blocks
+* OUTP: min-entropy per bit in [0, 1]
+* @ src : binary bit stream of length n bits
+* @ n : more than 6006 so that at least two blocks are tested
+*******************************************************************************/
+double rng_entropy_compression(const uint64_t * const src, const uint64_t n);
+
+/*******************************************************************************
+* NAME: rng_entropy
+* DESC: run all four estimators on a large capture in parallel with OpenMP. The
+*       stream is split into chunks and the partial counts are stitched at the
+*       chunk boundaries, so the results match the single estimators exactly.
+* OUTP: all four estimates and their minimum
+* @ src : binary bit stream of length n bits
+* @ n : more than 6006
+* @ threads : number of threads, at least 1
+*******************************************************************************/
+entropy_t rng_entropy
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const int threads
+);
+
+/*******************************************************************************
+* NAME: rng_nist_frequency
+* DESC: SP 800-22 frequency (monobit) test
+* OUTP: p-value in [0, 1]
+* @ src : binary bit stream of length n bits
+* @ n : nonzero, the standard recommends at least 100
+*******************************************************************************/
+double rng_nist_frequency(const uint64_t * const src, const uint64_t n);
+
+/*******************************************************************************
+* NAME: rng_nist_block_frequency
+* DESC: SP 800-22 frequency test within n / m blocks of m bits
+* OUTP: p-value in [0, 1]
+* NOTE: blocks which are a multiple of 64 bits are counted a word at a time
+* @ src : binary bit stream of length n bits
+* @ n : at least m
+* @ m : nonzero block length
+*******************************************************************************/
+double rng_nist_block_frequency
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const uint64_t m
+);
+
+/*******************************************************************************
+* NAME: rng_nist_runs
+* DESC: SP 800-22 runs test
+* OUTP: p-value in [0, 1], zero if the stream fails the frequency prerequisite
+* @ src : binary bit stream of length n bits
+* @ n : at least 2
+*******************************************************************************/
+double rng_nist_runs(const uint64_t * const src, const uint64_t n);
+
+/*******************************************************************************
+* NAME: rng_nist_longest_run
+* DESC: SP 800-22 longest run of ones in a block test
+* OUTP: p-value in [0, 1]
+* NOTE: blocks are 8, 128 or 10^4 bits as n reaches 128, 6272 or 750000
+* @ src : binary bit stream of length n bits
+* @ n : at least 128
+*******************************************************************************/
+double rng_nist_longest_run(const uint64_t * const src, const uint64_t n);
+
+/*******************************************************************************
+* NAME: rng_gf2_rank
+* DESC: rank over GF(2) of a square binary matrix by word-parallel elimination
+* OUTP: rank in [0, size]
+* @ rows : size rows, row i holds its columns in its lowest size bits
+* @ size : number of rows and columns in range [1, 64]
+*******************************************************************************/
+int rng_gf2_rank(const uint64_t * const rows, const int size);
+
+/*******************************************************************************
+* NAME: rng_linear_complexity
+* DESC: length of the shortest LFSR generating an n-bit binary bitstream, found
+*       with the Berlekamp-Massey algorithm a word at a time
+* OUTP: linear complexity in [0, n]
+* @ src : binary bit stream of length n bits
+* @ n : nonzero
+*******************************************************************************/
+uint64_t rng_linear_complexity(const uint64_t * const src, const uint64_t n);
+
+/*******************************************************************************
+* NAME: rng_nist_rank
+* DESC: SP 800-22 binary matrix rank test on disjoint 32 x 32 matrices
+* OUTP: p-value in [0, 1]
+* NOTE: each matrix is 16 consecutive words with one row in each 32-bit half
+* @ src : binary bit stream of length n bits
+* @ n : at least 38 matrices, 38912 bits
+*******************************************************************************/
+double rng_nist_rank(const uint64_t * const src, const uint64_t n);
+
+/*******************************************************************************
+* NAME: rng_nist_linear_complexity
+* DESC: SP 800-22 linear complexity test on n / m blocks of m bits
+* OUTP: p-value in [0, 1]
+* @ src : binary bit stream of length n bits
+* @ n : at least m, the standard recommends at least 200 blocks
+* @ m : block length, the standard recommends 500 to 5000
+* @ threads : number of threads, at least 1, the blocks are split between them
+*******************************************************************************/
+double rng_nist_linear_complexity
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const uint64_t m,
+    const int threads
+);
+
+/*******************************************************************************
+* NAME: rng_nist_serial
+* DESC: SP 800-22 serial test on overlapping m-bit patterns
+* OUTP: the two p-values are written to p
+* @ src : binary bit stream of length n bits
+* @ n : the standard recommends m < log2(n) - 2
+* @ m : pattern length in range [2, 24]
+* @ p : array of 2 p-values
+*******************************************************************************/
+void rng_nist_serial
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const int m,
+    double p[2]
+);
+
+/*******************************************************************************
+* NAME: rng_nist_approximate_entropy
+* DESC: SP 800-22 approximate entropy test on overlapping m-bit patterns
+* OUTP: p-value in [0, 1]
+* @ src : binary bit stream of length n bits
+* @ n : the standard recommends m < log2(n) - 5
+* @ m : pattern length in range [1, 23]
+*******************************************************************************/
+double rng_nist_approximate_entropy
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const int m
+);
+
+/*******************************************************************************
+* NAME: rng_nist_cusum
+* DESC: SP 800-22 cumulative sums test
+* OUTP: the forward and backward p-values are written to p
+* @ src : binary bit stream of length n bits
+* @ n : nonzero, the standard recommends at least 100
+* @ p : array of 2 p-values
+*******************************************************************************/
+void rng_nist_cusum(const uint64_t * const src, const uint64_t n, double p[2]);
+
+/*******************************************************************************
+* NAME: rng_nist
+* DESC: run the SP 800-22 battery above with one test per thread, then the
+*       linear complexity test with its blocks split over all threads
+* OUTP: all p-values, identical to those of the single tests
+* NOTE: block frequency uses the smallest multiple of 64 above n / 99 bits
+* NOTE: linear complexity uses 500-bit blocks
+* NOTE: serial uses m = min(16, log2(n) - 3), approximate entropy uses m = min(10,
+*       log2(n) - 6), and both share one pattern count
+* @ src : binary bit stream of length n bits
+* @ n : at least 2^16, the standard recommends at least 10^6
+* @ threads : number of threads, at least 1
+*******************************************************************************/
+nist_t rng_nist
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    const int threads
+);
+
+/*******************************************************************************
+* NAME: rng_nist_min
+* DESC: smallest p-value of an SP 800-22 battery
+* OUTP: p-value in [0, 1]
+* @ nist : battery results from rng_nist
+*******************************************************************************/
+double rng_nist_min(const nist_t nist);
+
+/*******************************************************************************
+* NAME: rng_lanes
+* DESC: cross-lane test of a multi-lane generator. The output is de-interleaved
+*       into its lanes, and the SP 800-22 battery is run on each lane, on the XOR
+*       of each pair of lanes, and on the interleaved stream itself.
+* OUTP: out[0, lanes) are the single lanes, then the pairs (0, 1), (0, 2), ...,
+*       (lanes - 2, lanes - 1), and the last entry is the interleaved stream
+* NOTE: word i of src belongs to lane i % lanes, as in the stores of simd_rng_next
+* @ src : interleaved output of words 64-bit words
+* @ words : a multiple of lanes, with at least 1024 words per lane
+* @ lanes : number of lanes, at least 2
+* @ out : array of lanes + lanes * (lanes - 1) / 2 + 1 batteries
+* @ threads : number of threads, at least 1, each battery runs on one thread
+*******************************************************************************/
+void rng_lanes
+(
+    const uint64_t * const src,
+    const uint64_t words,
+    const int lanes,
+    nist_t * const out,
+    const int threads
+);
+
+/*******************************************************************************
+* NAME: rng_histogram
+* DESC: add n samples to a histogram of bins unit width bins starting at zero
+* OUTP: counts[i] is increased by the number of samples equal to i
+* NOTE: samples of bins - 1 or more are counted in the last bin, so the tail of
+*       an unbounded sampler can be collected in one bin
+* @ src : array of n samples
+* @ n : number of samples
+* @ counts : array of bins counts
+* @ bins : nonzero number of bins
+*******************************************************************************/
+void rng_histogram
+(
+    const uint64_t * const src,
+    const uint64_t n,
+    uint64_t * const counts,
+    const uint64_t bins
+);
+
+/*******************************************************************************
+* NAME: rng_sample_histogram
+* DESC: draw n samples from a sampler in parallel with OpenMP and bin them as in
+*       rng_histogram. Each thread draws its share from its own generator.
+* OUTP: false if seed = 0 and no seed word could be drawn, counts are unchanged
+* NOTE: the counts depend on the seed and the thread count, not the scheduling
+* @ sample : sampler under test
+* @ ctx : parameters passed to every call of the sampler
+* @ seed : rng_init_many seed of the per thread generators, 0 is non-deterministic
+* @ n : number of samples
+* @ counts : array of bins counts, increased by the counts of the samples
+* @ bins : nonzero number of bins
+* @ threads : number of threads, at least 1
+*******************************************************************************/
+bool rng_sample_histogram
+(
+    const sampler_t sample,
+    const void * const ctx,
+    const uint64_t seed,
+    const uint64_t n,
+    uint64_t * const counts,
+    const uint64_t bins,
+    const int threads
+);
+
+/*******************************************************************************
+* NAME: rng_chi_square
+* DESC: Pearson chi-square test of a histogram against a discrete distribution
+* OUTP: statistic and p-value, the p-value is zero if a sample falls in a bin of
+*       zero probability
+* NOTE: bins of zero probability do not count towards the degrees of freedom, and
+*       the standard rule asks for an expected count of at least 5 in every bin
+* @ counts : array of bins counts with a nonzero total
+* @ probability : array of bins probabilities which sum to 1
+* @ bins : number of bins with a nonzero probability, at least 2
+*******************************************************************************/
+fit_t rng_chi_square
+(
+    const uint64_t * const counts,
+    const double * const probability,
+    const uint64_t bins
+);
+
+/*******************************************************************************
+* NAME: rng_ks
+* DESC: Kolmogorov-Smirnov test of a histogram against a discrete distribution
+* OUTP: largest distance between the empirical and expected distribution functions
+*       and its p-value from the asymptotic Kolmogorov distribution
+* NOTE: the p-value is exact in the limit for continuous distributions, and it is
+*       conservative for discrete ones where it can only be too large
+* @ counts : array of bins counts with a nonzero total
+* @ probability : array of bins probabilities which sum to 1
+* @ bins : nonzero number of bins
+*******************************************************************************/
+fit_t rng_ks
+(
+    const uint64_t * const counts,
+    const double * const probability,
+    const uint64_t bins
+);
+
+#endif
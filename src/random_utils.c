@@ -4,17 +4,131 @@
 * DESC: PRNG library utilities implementation
 */
 
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "random_utils.h"
+#include "instrument.h"
 
 #include <immintrin.h>
+#include <cpuid.h>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#ifdef __linux__
+    #include <sys/random.h>
+#endif
+
+/*******************************************************************************
+State of the background entropy pool. The ring is Dmitry Vyukov's bounded MPMC
+queue: each slot carries a sequence number which tells a producer or consumer if
+the slot is ready for its lap around the ring, so either end only needs a single
+compare-and-swap on its own index. The two indices sit on separate cache lines
+so that the refill threads and the callers of rng_init don't contend. Pullers
+announce themselves on the consumer line, so that rng_pool_stop can wait for
+the ones already inside the ring before it is freed.
+*/
+
+typedef struct
+{
+    uint64_t sequence;
+    uint64_t value;
+} slot_t;
+
+static struct
+{
+    uint64_t head;
+    uint64_t head_pad[7];
+    uint64_t tail;
+    uint64_t pullers;
+    uint64_t tail_pad[6];
+    slot_t *slots;
+    uint64_t mask;
+    pthread_t *threads;
+    size_t count;
+    int running;
+    int use_rdseed;
+    uint64_t produced;
+    uint64_t consumed;
+    uint64_t underflows;
+    struct timespec start;
+    struct timespec stop;
+} pool;
+
+/*******************************************************************************
+The seeding chain, and the buffer of words from the last getrandom() call which
+is shared by all threads so that one syscall covers many seeds.
+*/
+
+static int seed_chain = SEED_RDRAND | SEED_GETRANDOM | SEED_CLOCK;
+
+/*******************************************************************************
+The hardware sources found by CPUID, detected on first use since -1 is never a
+valid set, and the mask of rng_seed_hardware applied on top of them.
+*/
+
+static int cpu_sources = -1;
+static int hardware_mask = SEED_RDSEED | SEED_RDRAND;
+
+static struct
+{
+    pthread_mutex_t lock;
+    uint64_t words[64];
+    size_t left;
+} syscall_buffer = {.lock = PTHREAD_MUTEX_INITIALIZER, .words = {0}, .left = 0};
+
+#ifdef RNG_INSTRUMENT
+
+/*******************************************************************************
+Counters of the instrumented build. The thresholds start at half of each period
+and the names follow the order of api_t.
+*/
+
+uint64_t rng_usage_threshold[2] = {1ULL << 63, 1ULL << 31};
+
+static double usage_fraction = 0.5;
+static uint64_t usage_warnings = 0;
+static usage_t usage[API_COUNT];
+
+static const char *usage_names[API_COUNT] =
+{
+    "rng_rand",
+    "rng_bias",
+    "rng_bias_lanes",
+    "rng_bino",
+    "rng_kmask",
+    "rng_markov",
+    "simd_rng_bias",
+    "simd_rng_bias_lanes",
+    "simd_rng_bino",
+    "simd_rng_bern"
+};
+
+#endif
+
+//static prototypes
+static uint64_t count_runs(uint64_t x, const uint64_t c);
+static int hardware_sources(void);
+static int seed_batch(const int chain, uint64_t *dest, const size_t n, int *used);
+static bool getrandom_word(uint64_t *x);
+static uint64_t clock_word(void);
+static bool pool_push(const uint64_t x);
+static void *pool_fill(void *arg);
 
 /*******************************************************************************
 Retry loop for RDRAND x86 instruction. Per the Intel documentation, we give up 
-after ten failures.
+after ten failures. A CPU without RDRAND, such as some virtual machines, fails
+straight away instead of raising SIGILL.
 */
 
 bool rdrand(uint64_t *x)
 {
+    if (!(hardware_sources() & SEED_RDRAND)) return false;
+    
     for (size_t i = 0; i < 10; i++)
     {
         if (_rdrand64_step(x))
@@ -26,6 +140,274 @@ bool rdrand(uint64_t *x)
     return false;
 }
 
+/*******************************************************************************
+RDSEED draws from the conditioned entropy source directly and runs dry far more
+often than RDRAND, so Intel recommends a pause and many more retries. It fails
+straight away on a CPU without RDSEED.
+*/
+
+bool rdseed(uint64_t *x)
+{
+    unsigned long long value;
+    
+    if (!(hardware_sources() & SEED_RDSEED)) return false;
+    
+    for (size_t i = 0; i < 100; i++)
+    {
+        if (_rdseed64_step(&value))
+        {
+            *x = (uint64_t) value;
+            return true;
+        }
+        
+        _mm_pause();
+    }
+    
+    return false;
+}
+
+/*******************************************************************************
+The pool is tried first since a pull is a few nanoseconds against hundreds of
+cycles for RDRAND, which is also shared by every core on the package.
+*/
+
+bool rdrand_pooled(uint64_t *x)
+{
+    return rng_pool_pull(x) || rdrand(x);
+}
+
+/******************************************************************************/
+
+int rng_seed_chain
+(
+    const int sources
+)
+{
+    return __atomic_exchange_n(&seed_chain, sources, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************/
+
+int rng_seed_hardware
+(
+    const int sources
+)
+{
+    return __atomic_exchange_n(&hardware_mask, sources, __ATOMIC_RELAXED);
+}
+
+/*******************************************************************************
+The batch must pass the SP 800-90B health tests, which at full entropy just means
+no word repeats. A stuck or all-ones source, like the AMD rdrand erratum, fails
+them while still reporting success, so the strongest source used in the batch is
+dropped from the chain and the whole batch is drawn again. Each retry removes a
+source, so this ends once a batch passes or the chain is empty.
+*/
+
+int rng_seed_words
+(
+    uint64_t * const dest, 
+    const size_t n
+)
+{
+    assert(dest != NULL && "null destination");
+    
+    int chain = __atomic_load_n(&seed_chain, __ATOMIC_RELAXED);
+    int weakest;
+    int used;
+    health_t health;
+    
+    while ((weakest = seed_batch(chain, dest, n, &used)) != 0)
+    {
+        health = rng_health_init(64.0, false);
+        
+        if (rng_health_words(&health, dest, n)) return weakest;
+        
+        chain &= ~(used & -used);
+    }
+    
+    return 0;
+}
+
+/*******************************************************************************
+The ring is allocated before the threads start and the counters are reset, so
+the stats always describe the current run of the pool. A thread that fails to
+start tears the whole pool down again, and a CPU without the instruction never
+starts it, since the threads would spin on a source that always fails.
+*/
+
+bool rng_pool_start
+(
+    const size_t capacity, 
+    const size_t threads, 
+    const bool use_rdseed
+)
+{
+    assert(capacity > 0 && "empty ring");
+    assert(threads > 0 && "no refill threads");
+    
+    uint64_t size = 1;
+    
+    if (__atomic_load_n(&pool.running, __ATOMIC_ACQUIRE)) return false;
+    
+    if (!(hardware_sources() & (use_rdseed ? SEED_RDSEED : SEED_RDRAND))) return false;
+    
+    while (size < capacity) size <<= 1;
+    
+    pool.slots = malloc(size * sizeof(slot_t));
+    pool.threads = malloc(threads * sizeof(pthread_t));
+    
+    if (pool.slots == NULL || pool.threads == NULL)
+    {
+        free(pool.slots);
+        free(pool.threads);
+        pool.slots = NULL;
+        pool.threads = NULL;
+        return false;
+    }
+    
+    for (uint64_t i = 0; i < size; i++) pool.slots[i].sequence = i;
+    
+    pool.head = 0;
+    pool.tail = 0;
+    pool.mask = size - 1;
+    pool.count = 0;
+    pool.use_rdseed = use_rdseed;
+    pool.produced = 0;
+    pool.consumed = 0;
+    pool.underflows = 0;
+    clock_gettime(CLOCK_MONOTONIC, &pool.start);
+    
+    __atomic_store_n(&pool.running, 1, __ATOMIC_RELEASE);
+    
+    for (; pool.count < threads; pool.count++)
+    {
+        if (pthread_create(pool.threads + pool.count, NULL, pool_fill, NULL))
+        {
+            rng_pool_stop();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/*******************************************************************************
+A puller increments pullers before it reads running, and stop clears running
+before it reads pullers, both sequentially consistent. So either the puller sees
+the pool stopped and leaves the ring alone, or stop sees the puller and waits
+for it to leave before the ring is freed.
+*/
+
+void rng_pool_stop(void)
+{
+    __atomic_store_n(&pool.running, 0, __ATOMIC_SEQ_CST);
+    
+    for (size_t i = 0; i < pool.count; i++)
+    {
+        pthread_join(pool.threads[i], NULL);
+    }
+    
+    while (__atomic_load_n(&pool.pullers, __ATOMIC_SEQ_CST) != 0) _mm_pause();
+    
+    clock_gettime(CLOCK_MONOTONIC, &pool.stop);
+    
+    free(pool.slots);
+    free(pool.threads);
+    pool.slots = NULL;
+    pool.threads = NULL;
+    pool.count = 0;
+}
+
+/*******************************************************************************
+Consumer side of the ring. A slot is filled for this lap when its sequence is one
+past the index, and releasing it sets the sequence one lap ahead for producers.
+A pool that is already stopped is left at a plain load, since the ring is never
+touched, so that rng_init on an unused pool costs no atomic writes. Only an
+empty ring counts as an underflow.
+*/
+
+bool rng_pool_pull(uint64_t *x)
+{
+    uint64_t pos;
+    slot_t *slot;
+    int64_t diff;
+    bool pulled = false;
+    
+    if (!__atomic_load_n(&pool.running, __ATOMIC_RELAXED)) return false;
+    
+    __atomic_add_fetch(&pool.pullers, 1, __ATOMIC_SEQ_CST);
+    
+    if (!__atomic_load_n(&pool.running, __ATOMIC_SEQ_CST)) goto terminate;
+    
+    pos = __atomic_load_n(&pool.tail, __ATOMIC_RELAXED);
+    
+    while (true)
+    {
+        slot = pool.slots + (pos & pool.mask);
+        diff = (int64_t) (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - pos);
+        diff -= 1;
+        
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&pool.tail, &pos, pos + 1, true, 
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            __atomic_add_fetch(&pool.underflows, 1, __ATOMIC_RELAXED);
+            goto terminate;
+        }
+        else
+        {
+            pos = __atomic_load_n(&pool.tail, __ATOMIC_RELAXED);
+        }
+    }
+    
+    *x = slot->value;
+    __atomic_store_n(&slot->sequence, pos + pool.mask + 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&pool.consumed, 1, __ATOMIC_RELAXED);
+    pulled = true;
+    
+    terminate:
+        __atomic_sub_fetch(&pool.pullers, 1, __ATOMIC_RELEASE);
+        return pulled;
+}
+
+/******************************************************************************/
+
+pool_stats_t rng_pool_stats(void)
+{
+    struct timespec now;
+    
+    if (__atomic_load_n(&pool.running, __ATOMIC_ACQUIRE))
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+    else
+    {
+        now = pool.stop;
+    }
+    
+    const double elapsed = (double) (now.tv_sec - pool.start.tv_sec) 
+                         + (double) (now.tv_nsec - pool.start.tv_nsec) * 1e-9;
+    
+    pool_stats_t stats =
+    {
+        .produced = __atomic_load_n(&pool.produced, __ATOMIC_RELAXED),
+        .consumed = __atomic_load_n(&pool.consumed, __ATOMIC_RELAXED),
+        .underflows = __atomic_load_n(&pool.underflows, __ATOMIC_RELAXED),
+        .rate = 0.0
+    };
+    
+    if (elapsed > 0.0) stats.rate = (double) stats.produced / elapsed;
+    
+    return stats;
+}
+
 /*******************************************************************************
 This is used to mix a user-supplied seed, it is Sebastiano Vigna's version of
 Java's SplittableRandom: http://xoshiro.di.unimi.it/splitmix64.c but since its
@@ -46,3 +428,711 @@ uint64_t rng_hash
     
     return value;
 }
+
+/*******************************************************************************
+The low 64 bits of a * b are lo(a) * lo(b) + ((hi(a) * lo(b) + lo(a) * hi(b))
+<< 32), and mul_epu32 only reads the low 32 bits of each block so the masking
+is free.
+*/
+
+__m256i simd_rng_hash
+(
+    __m256i value
+)
+{
+    const __m256i multipliers[2] = 
+    {
+        _mm256_set1_epi64x((int64_t) 0xbf58476d1ce4e5b9ULL),
+        _mm256_set1_epi64x((int64_t) 0x94d049bb133111ebULL)
+    };
+    
+    const int shifts[3] = {30, 27, 31};
+    __m256i cross;
+    
+    for (size_t i = 0; i < 2; i++)
+    {
+        value = _mm256_xor_si256(value, _mm256_srli_epi64(value, shifts[i]));
+        
+        cross = _mm256_add_epi64
+        (
+            _mm256_mul_epu32(_mm256_srli_epi64(value, 32), multipliers[i]),
+            _mm256_mul_epu32(value, _mm256_srli_epi64(multipliers[i], 32))
+        );
+        
+        value = _mm256_add_epi64
+        (
+            _mm256_mul_epu32(value, multipliers[i]),
+            _mm256_slli_epi64(cross, 32)
+        );
+    }
+    
+    return _mm256_xor_si256(value, _mm256_srli_epi64(value, shifts[2]));
+}
+
+/*******************************************************************************
+NIST SP 800-90B section 4.4. The repetition count test fails on C = 1 + 20/H
+identical samples in a row. The adaptive proportion test takes the first sample
+of each window and fails when C of the W - 1 samples after it match. C is one
+more than the 1 - 2^-20 quantile of a Binomial(W - 1, 2^-H), which we find by
+summing the mass function in log space. For 64-bit samples with full entropy
+both cutoffs come out small, so any repeated word fails.
+*/
+
+health_t rng_health_init
+(
+    const double h, 
+    const bool binary
+)
+{
+    assert(h > 0.0 && h <= (binary ? 1.0 : 64.0) && "invalid min-entropy");
+    
+    const double alpha = 0x1p-20;
+    const double p = exp2(-h);
+    
+    health_t health =
+    {
+        .last = 0,
+        .run = 0,
+        .rct_cutoff = 1 + (uint64_t) ceil(20.0 / h),
+        .first = 0,
+        .matches = 0,
+        .seen = 0,
+        .window = binary ? 1024 : 512,
+        .apt_cutoff = 0,
+        .failures = 0
+    };
+    
+    const double trials = (double) (health.window - 1);
+    double cdf = 0.0;
+    double k = 0.0;
+    
+    for (; k < trials; k++)
+    {
+        cdf += exp
+        (
+            lgamma(trials + 1.0) - lgamma(k + 1.0) - lgamma(trials - k + 1.0)
+            + k * log(p) + (trials - k) * log1p(-p)
+        );
+        
+        if (cdf >= 1.0 - alpha) break;
+    }
+    
+    health.apt_cutoff = 1 + (uint64_t) k;
+    
+    return health;
+}
+
+/*******************************************************************************
+Both tests on 64-bit samples. A healthy source almost never repeats a word, so
+each step compares four samples with their predecessors and four samples with
+the first sample of the window, and only drops to scalar code on a match.
+*/
+
+bool rng_health_words
+(
+    health_t * const health, 
+    const uint64_t * const src, 
+    const size_t n
+)
+{
+    assert(health != NULL && "null health test");
+    assert(src != NULL && "null source");
+    assert(health->window == 512 && "health test is binary");
+    
+    const uint64_t failures = health->failures;
+    __m256i first;
+    size_t i = 0;
+    size_t end;
+    int mask;
+    
+    //repetition count test
+    while (i < n)
+    {
+        if (i != 0 && i + 4 <= n)
+        {
+            mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64
+            (
+                _mm256_loadu_si256((const __m256i *) (src + i)),
+                _mm256_loadu_si256((const __m256i *) (src + i - 1))
+            )));
+            
+            if (mask == 0)
+            {
+                health->last = src[i + 3];
+                health->run = 1;
+                i += 4;
+                continue;
+            }
+        }
+        
+        end = i + 4 < n ? i + 4 : n;
+        
+        for (; i < end; i++)
+        {
+            if (health->run != 0 && src[i] == health->last)
+            {
+                if (++health->run == health->rct_cutoff) health->failures++;
+            }
+            else
+            {
+                health->last = src[i];
+                health->run = 1;
+            }
+        }
+    }
+    
+    //adaptive proportion test
+    for (i = 0; i < n;)
+    {
+        if (health->seen == 0)
+        {
+            health->first = src[i++];
+            health->matches = 0;
+            health->seen = 1;
+            continue;
+        }
+        
+        end = i + (health->window - health->seen);
+        if (end > n) end = n;
+        
+        const uint64_t before = health->matches;
+        health->seen += end - i;
+        first = _mm256_set1_epi64x((int64_t) health->first);
+        
+        for (; i + 4 <= end; i += 4)
+        {
+            mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64
+            (
+                _mm256_loadu_si256((const __m256i *) (src + i)), 
+                first
+            )));
+            
+            health->matches += (uint64_t) __builtin_popcount((unsigned) mask);
+        }
+        
+        for (; i < end; i++)
+        {
+            health->matches += src[i] == health->first;
+        }
+        
+        if (before < health->apt_cutoff && health->matches >= health->apt_cutoff)
+        {
+            health->failures++;
+        }
+        
+        if (health->seen == health->window) health->seen = 0;
+    }
+    
+    return health->failures == failures;
+}
+
+/*******************************************************************************
+Both tests on a binary source. For the repetition count test each word is split
+into the run at its low end, which continues the run from the previous word,
+the run at its high end, which carries into the next word, and the bits between
+them, where runs of C identical bits are counted with AND-shifts. For the
+adaptive proportion test the matches are counted by popcount on masked words.
+*/
+
+bool rng_health_bits
+(
+    health_t * const health, 
+    const uint64_t * const src, 
+    const uint64_t n
+)
+{
+    assert(health != NULL && "null health test");
+    assert(src != NULL && "null source");
+    assert(health->window == 1024 && "health test is not binary");
+    
+    const uint64_t failures = health->failures;
+    const uint64_t c = health->rct_cutoff;
+    uint64_t valid;
+    uint64_t mask;
+    uint64_t w;
+    uint64_t x;
+    uint64_t b;
+    uint64_t low;
+    uint64_t high;
+    uint64_t inner;
+    uint64_t len;
+    uint64_t ones;
+    
+    //repetition count test
+    for (uint64_t i = 0; i < n; i += 64)
+    {
+        valid = n - i < 64 ? n - i : 64;
+        mask = ~0ULL >> (64 - valid);
+        w = src[i / 64];
+        
+        b = w & 1;
+        x = (b ? ~w : w) & mask;
+        low = x ? (uint64_t) __builtin_ctzll(x) : valid;
+        
+        if (health->run != 0 && b == health->last)
+        {
+            if (health->run < c && health->run + low >= c) health->failures++;
+            health->run += low;
+        }
+        else
+        {
+            if (low >= c) health->failures++;
+            health->run = low;
+        }
+        
+        health->last = b;
+        
+        if (low == valid) continue;
+        
+        b = (w >> (valid - 1)) & 1;
+        high = (uint64_t) __builtin_clzll((b ? ~w : w) << (64 - valid));
+        
+        inner = mask & ~(~0ULL >> (64 - low)) & (~0ULL >> (64 - (valid - high)));
+        
+        if (c < 64)
+        {
+            health->failures += count_runs(w & inner, c) + count_runs(~w & inner, c);
+        }
+        
+        if (high >= c) health->failures++;
+        
+        health->last = b;
+        health->run = high;
+    }
+    
+    //adaptive proportion test
+    for (uint64_t i = 0; i < n;)
+    {
+        if (health->seen == 0)
+        {
+            health->first = (src[i / 64] >> (i % 64)) & 1;
+            health->matches = 0;
+            health->seen = 1;
+            i++;
+            continue;
+        }
+        
+        len = health->window - health->seen;
+        if (len > n - i) len = n - i;
+        if (len > 64 - i % 64) len = 64 - i % 64;
+        
+        const uint64_t before = health->matches;
+        x = (src[i / 64] >> (i % 64)) & (~0ULL >> (64 - len));
+        ones = (uint64_t) __builtin_popcountll(x);
+        
+        health->matches += health->first ? ones : len - ones;
+        health->seen += len;
+        i += len;
+        
+        if (before < health->apt_cutoff && health->matches >= health->apt_cutoff)
+        {
+            health->failures++;
+        }
+        
+        if (health->seen == health->window) health->seen = 0;
+    }
+    
+    return health->failures == failures;
+}
+
+#ifdef RNG_INSTRUMENT
+
+/*******************************************************************************
+A random_t counts its draws in 64 bits, so a fraction of 1 is clamped to the
+last draw before the counter wraps. A zero threshold is never matched since the
+count is incremented before it is compared.
+*/
+
+double rng_usage_limit
+(
+    const double fraction
+)
+{
+    assert(fraction >= 0.0 && fraction <= 1.0 && "invalid fraction");
+    
+    const double previous = usage_fraction;
+    
+    usage_fraction = fraction;
+    rng_usage_threshold[0] = (uint64_t) fmin(ldexp(fraction, 64), 0x1p64 - 0x1p11);
+    rng_usage_threshold[1] = (uint64_t) ldexp(fraction, 32);
+    
+    return previous;
+}
+
+/******************************************************************************/
+
+uint64_t rng_usage_warnings(void)
+{
+    return __atomic_load_n(&usage_warnings, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************/
+
+usage_t rng_usage
+(
+    const api_t api
+)
+{
+    assert(api < API_COUNT && "invalid api");
+    
+    usage_t snapshot =
+    {
+        .calls = __atomic_load_n(&usage[api].calls, __ATOMIC_RELAXED),
+        .words = __atomic_load_n(&usage[api].words, __ATOMIC_RELAXED)
+    };
+    
+    return snapshot;
+}
+
+/******************************************************************************/
+
+void rng_usage_reset(void)
+{
+    for (int i = 0; i < API_COUNT; i++)
+    {
+        __atomic_store_n(&usage[i].calls, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&usage[i].words, 0, __ATOMIC_RELAXED);
+    }
+    
+    __atomic_store_n(&usage_warnings, 0, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************/
+
+void rng_usage_report
+(
+    FILE * const stream
+)
+{
+    assert(stream != NULL && "null stream");
+    
+    usage_t snapshot;
+    
+    fprintf(stream, "%-20s %16s %16s %12s\n", "function", "calls", "words", "per call");
+    
+    for (int i = 0; i < API_COUNT; i++)
+    {
+        snapshot = rng_usage((api_t) i);
+        
+        if (snapshot.calls == 0) continue;
+        
+        fprintf
+        (
+            stream, 
+            "%-20s %16llu %16llu %12.2f\n", 
+            usage_names[i], 
+            (unsigned long long) snapshot.calls, 
+            (unsigned long long) snapshot.words,
+            (double) snapshot.words / (double) snapshot.calls
+        );
+    }
+    
+    fprintf
+    (
+        stream, 
+        "generators past %g of their period: %llu\n", 
+        usage_fraction,
+        (unsigned long long) rng_usage_warnings()
+    );
+}
+
+/*******************************************************************************
+Generators are shared by nothing but their own thread, while the counters are
+shared by every thread, so they are updated atomically.
+*/
+
+void rng_usage_add
+(
+    const api_t api, 
+    const uint64_t words
+)
+{
+    __atomic_add_fetch(&usage[api].calls, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&usage[api].words, words, __ATOMIC_RELAXED);
+}
+
+/*******************************************************************************
+Only reached once per generator, when its draw count steps onto the threshold.
+*/
+
+void rng_usage_warn
+(
+    const int simd, 
+    const uint64_t draws
+)
+{
+    __atomic_add_fetch(&usage_warnings, 1, __ATOMIC_RELAXED);
+    
+    fprintf
+    (
+        stderr, 
+        "rng: %s has used %g of its period after %llu draws\n",
+        simd ? "a simd_random_t lane" : "a random_t",
+        usage_fraction,
+        (unsigned long long) draws
+    );
+}
+
+#endif
+
+/*******************************************************************************
+Number of runs of at least c consecutive set bits in x, 0 < c < 64. After each
+step bit i of x is set only if bits i through i + len - 1 were all set, so every
+long run leaves one block of set bits and we count the lowest bit of each block.
+*/
+
+static uint64_t count_runs
+(
+    uint64_t x, 
+    const uint64_t c
+)
+{
+    uint64_t len = 1;
+    uint64_t shift;
+    
+    while (len < c && x)
+    {
+        shift = len < c - len ? len : c - len;
+        x &= x >> shift;
+        len += shift;
+    }
+    
+    return (uint64_t) __builtin_popcountll(x & ~(x << 1));
+}
+
+/*******************************************************************************
+Producer side of the ring, the mirror image of rng_pool_pull.
+*/
+
+static bool pool_push
+(
+    const uint64_t x
+)
+{
+    uint64_t pos = __atomic_load_n(&pool.head, __ATOMIC_RELAXED);
+    slot_t *slot;
+    int64_t diff;
+    
+    while (true)
+    {
+        slot = pool.slots + (pos & pool.mask);
+        diff = (int64_t) (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - pos);
+        
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&pool.head, &pos, pos + 1, true, 
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = __atomic_load_n(&pool.head, __ATOMIC_RELAXED);
+        }
+    }
+    
+    slot->value = x;
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+    
+    return true;
+}
+
+/*******************************************************************************
+Each word walks down the chain on its own, so a source that fails part way
+through a batch only costs the words it could not produce. Since the flags are
+ordered from strongest to weakest, the weakest source used is the largest flag.
+*/
+
+static int seed_batch
+(
+    const int chain, 
+    uint64_t *dest, 
+    const size_t n, 
+    int *used
+)
+{
+    int weakest = 0;
+    int source;
+    
+    *used = 0;
+    
+    for (size_t i = 0; i < n; i++)
+    {
+        if ((chain & SEED_RDSEED) && rdseed(dest + i))
+        {
+            source = SEED_RDSEED;
+        }
+        else if ((chain & SEED_RDRAND) && rdrand_pooled(dest + i))
+        {
+            source = SEED_RDRAND;
+        }
+        else if ((chain & SEED_GETRANDOM) && getrandom_word(dest + i))
+        {
+            source = SEED_GETRANDOM;
+        }
+        else if (chain & SEED_CLOCK)
+        {
+            dest[i] = clock_word();
+            source = SEED_CLOCK;
+        }
+        else
+        {
+            return 0;
+        }
+        
+        if (source > weakest) weakest = source;
+        *used |= source;
+    }
+    
+    return weakest;
+}
+
+/*******************************************************************************
+RDRAND is CPUID.1:ECX bit 30 and RDSEED is CPUID.7.0:EBX bit 18. Every thread
+that races on the first call detects the same set, so the relaxed store is fine.
+*/
+
+static int hardware_sources(void)
+{
+    unsigned int eax;
+    unsigned int ebx;
+    unsigned int ecx;
+    unsigned int edx;
+    int found = __atomic_load_n(&cpu_sources, __ATOMIC_RELAXED);
+    
+    if (found < 0)
+    {
+        found = 0;
+        
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1U << 30)))
+        {
+            found |= SEED_RDRAND;
+        }
+        
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1U << 18)))
+        {
+            found |= SEED_RDSEED;
+        }
+        
+        __atomic_store_n(&cpu_sources, found, __ATOMIC_RELAXED);
+    }
+    
+    return found & __atomic_load_n(&hardware_mask, __ATOMIC_RELAXED);
+}
+
+/*******************************************************************************
+Refill thread. A word is held until there is room for it, and the thread naps
+while the ring is full or the instruction is out of entropy rather than spin on
+a core that the simulation could use.
+*/
+
+static void *pool_fill
+(
+    void *arg
+)
+{
+    const struct timespec nap = {.tv_sec = 0, .tv_nsec = 50000};
+    uint64_t x;
+    bool valid;
+    
+    (void) arg;
+    
+    while (__atomic_load_n(&pool.running, __ATOMIC_ACQUIRE))
+    {
+        valid = pool.use_rdseed ? rdseed(&x) : rdrand(&x);
+        
+        if (!valid)
+        {
+            nanosleep(&nap, NULL);
+            continue;
+        }
+        
+        while (!pool_push(x))
+        {
+            if (!__atomic_load_n(&pool.running, __ATOMIC_ACQUIRE)) return NULL;
+            nanosleep(&nap, NULL);
+        }
+        
+        __atomic_add_fetch(&pool.produced, 1, __ATOMIC_RELAXED);
+    }
+    
+    return NULL;
+}
+
+/*******************************************************************************
+Words are handed out from the top of the buffer and wiped as they go. The call
+never blocks, so early in boot when the kernel pool is not yet initialized it
+fails and the chain moves on to the clock.
+*/
+
+static bool getrandom_word
+(
+    uint64_t *x
+)
+{
+    #ifdef __linux__
+        bool valid = true;
+        
+        pthread_mutex_lock(&syscall_buffer.lock);
+        
+        if (syscall_buffer.left == 0)
+        {
+            const ssize_t size = (ssize_t) sizeof(syscall_buffer.words);
+            
+            if (getrandom(syscall_buffer.words, (size_t) size, GRND_NONBLOCK) == size)
+            {
+                syscall_buffer.left = 64;
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        
+        if (valid)
+        {
+            *x = syscall_buffer.words[--syscall_buffer.left];
+            syscall_buffer.words[syscall_buffer.left] = 0;
+        }
+        
+        pthread_mutex_unlock(&syscall_buffer.lock);
+        
+        return valid;
+    #else
+        (void) x;
+        return false;
+    #endif
+}
+
+/*******************************************************************************
+Last resort. Two clocks and the timestamp counter supply the jitter, the address
+of a stack variable and of a static variable supply whatever ASLR randomized,
+and a counter keeps two calls within the same clock tick apart. Each input is
+folded in through rng_hash.
+*/
+
+static uint64_t clock_word(void)
+{
+    static uint64_t counter = 0;
+    
+    struct timespec mono;
+    struct timespec real;
+    uint64_t x;
+    
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+    
+    x = rng_hash((uint64_t) mono.tv_sec << 30 ^ (uint64_t) mono.tv_nsec);
+    x = rng_hash(x ^ (uint64_t) real.tv_sec << 30 ^ (uint64_t) real.tv_nsec);
+    x = rng_hash(x ^ (uint64_t) __rdtsc());
+    x = rng_hash(x ^ (uint64_t) (uintptr_t) &mono);
+    x = rng_hash(x ^ (uint64_t) (uintptr_t) &counter);
+    x = rng_hash(x ^ __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED));
+    
+    return x;
+}
@@ -9,15 +9,207 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <immintrin.h>
+
+#ifdef RNG_INSTRUMENT
+    #include <stdio.h>
+#endif
+
+/*******************************************************************************
+* NAME: health_t
+* DESC: running state of the SP 800-90B continuous health tests on a source
+* @ last : previous sample, for the repetition count test
+* @ run : total consecutive samples equal to the previous sample
+* @ rct_cutoff : repetition count at which the source fails
+* @ first : first sample of the current adaptive proportion window
+* @ matches : samples equal to first in the current window, excluding first
+* @ seen : samples in the current window so far
+* @ window : size of the adaptive proportion window, 1024 bits or 512 words
+* @ apt_cutoff : matches at which the source fails
+* @ failures : total failures since initialization
+*******************************************************************************/
+typedef struct
+{
+    uint64_t last;
+    uint64_t run;
+    uint64_t rct_cutoff;
+    uint64_t first;
+    uint64_t matches;
+    uint64_t seen;
+    uint64_t window;
+    uint64_t apt_cutoff;
+    uint64_t failures;
+} health_t;
+
+/*******************************************************************************
+* NAME: seed_source_t
+* DESC: sources of non-deterministic seeds, from strongest to weakest. A chain
+*       of sources is any bitwise OR of these, see rng_seed_chain.
+* @ SEED_RDSEED : x86 rdseed, full entropy but slow and prone to running dry
+* @ SEED_RDRAND : the entropy pool if running, else x86 rdrand
+* @ SEED_GETRANDOM : getrandom() syscall without blocking, batched, Linux only
+* @ SEED_CLOCK : hash of clocks, timestamp counter and ASLR'd addresses
+*******************************************************************************/
+typedef enum
+{
+    SEED_RDSEED = 1,
+    SEED_RDRAND = 2,
+    SEED_GETRANDOM = 4,
+    SEED_CLOCK = 8
+} seed_source_t;
+
+/*******************************************************************************
+* NAME: pool_stats_t
+* DESC: counters of the background entropy pool since the last rng_pool_start
+* @ produced : words written into the ring by the background threads
+* @ consumed : words pulled out of the ring
+* @ underflows : pulls that found the ring empty
+* @ rate : produced words per second since the pool was started
+*******************************************************************************/
+typedef struct
+{
+    uint64_t produced;
+    uint64_t consumed;
+    uint64_t underflows;
+    double rate;
+} pool_stats_t;
+
+#ifdef RNG_INSTRUMENT
+
+/*******************************************************************************
+* NAME: api_t
+* DESC: sampling functions whose calls are counted in an RNG_INSTRUMENT build
+*******************************************************************************/
+typedef enum
+{
+    API_RNG_RAND,
+    API_RNG_BIAS,
+    API_RNG_BIAS_LANES,
+    API_RNG_BINO,
+    API_RNG_KMASK,
+    API_RNG_MARKOV,
+    API_SIMD_RNG_BIAS,
+    API_SIMD_RNG_BIAS_LANES,
+    API_SIMD_RNG_BINO,
+    API_SIMD_RNG_BERN,
+    API_COUNT
+} api_t;
+
+/*******************************************************************************
+* NAME: usage_t
+* DESC: counters of one sampling function since the last rng_usage_reset
+* @ calls : completed calls from all threads
+* @ words : generator outputs consumed by those calls, 64-bit rng_next words for
+*           the 64-bit API and 256-bit simd_rng_next vectors for the AVX2 API
+*******************************************************************************/
+typedef struct
+{
+    uint64_t calls;
+    uint64_t words;
+} usage_t;
+
+#endif
 
 /*******************************************************************************
 * NAME: rdrand
 * DESC: Retry loop for x86 rdrand instruction
-* OUTP: false if rdrand could not generate a number within 10 attempts
+* OUTP: false if the CPU lacks rdrand or it failed to generate a number within
+*       10 attempts
 * @ x : contains valid random number if and only if the function returns true
 *******************************************************************************/
 bool rdrand(uint64_t *x);
 
+/*******************************************************************************
+* NAME: rdseed
+* DESC: Retry loop for x86 rdseed instruction, with a pause between attempts
+* OUTP: false if the CPU lacks rdseed or it failed to generate a number within
+*       100 attempts
+* @ x : contains valid random number if and only if the function returns true
+*******************************************************************************/
+bool rdseed(uint64_t *x);
+
+/*******************************************************************************
+* NAME: rdrand_pooled
+* DESC: pull a prefetched word from the entropy pool, or call rdrand directly if
+*       the pool is stopped or empty. rng_init and simd_rng_init seed with this.
+* OUTP: false if the pool was empty and rdrand failed
+* @ x : contains valid random number if and only if the function returns true
+*******************************************************************************/
+bool rdrand_pooled(uint64_t *x);
+
+/*******************************************************************************
+* NAME: rng_seed_chain
+* DESC: select at runtime which sources the seeding chain may fall back through.
+*       The default is SEED_RDRAND | SEED_GETRANDOM | SEED_CLOCK. Leave out the
+*       weaker sources to make rng_init fail with a zero state instead.
+* OUTP: the previous chain
+* @ sources : bitwise OR of seed_source_t values
+*******************************************************************************/
+int rng_seed_chain(const int sources);
+
+/*******************************************************************************
+* NAME: rng_seed_hardware
+* DESC: mask the hardware sources that CPUID reports, so that a host without
+*       rdrand or rdseed can be emulated. A masked instruction fails at once and
+*       the chain moves on. The default is SEED_RDSEED | SEED_RDRAND.
+* OUTP: the previous mask
+* @ sources : bitwise OR of SEED_RDSEED and SEED_RDRAND
+*******************************************************************************/
+int rng_seed_hardware(const int sources);
+
+/*******************************************************************************
+* NAME: rng_seed_words
+* DESC: fill an array with non-deterministic seeds, each word from the strongest
+*       source in the chain that succeeds. A batch that fails the health tests
+*       is drawn again without its strongest source. Safe to call from any
+*       thread.
+* OUTP: weakest seed_source_t used, or 0 if every source in the chain failed or
+*       was rejected by the health tests
+* @ dest : array of n words
+*******************************************************************************/
+int rng_seed_words(uint64_t * const dest, const size_t n);
+
+/*******************************************************************************
+* NAME: rng_pool_start
+* DESC: start background threads that keep a lock-free ring of rdrand or rdseed
+*       words full. Start and stop must not race with each other, pulls from
+*       other threads may overlap either one.
+* OUTP: false if the pool is already running, the CPU lacks the instruction, or
+*       the pool could not be created
+* @ capacity : ring size in words, rounded up to a power of 2
+* @ threads : number of background threads, at least 1
+* @ use_rdseed : fill the ring from rdseed instead of rdrand
+*******************************************************************************/
+bool rng_pool_start
+(
+    const size_t capacity, 
+    const size_t threads, 
+    const bool use_rdseed
+);
+
+/*******************************************************************************
+* NAME: rng_pool_stop
+* DESC: join the background threads, wait for pulls in progress and release the
+*       ring, counters are kept
+*******************************************************************************/
+void rng_pool_stop(void);
+
+/*******************************************************************************
+* NAME: rng_pool_pull
+* DESC: take one prefetched word from the ring, safe from any number of threads
+* OUTP: false if the ring is empty or the pool is stopped. An empty ring counts
+*       as an underflow, a pull on a stopped pool does not.
+* @ x : contains valid random number if and only if the function returns true
+*******************************************************************************/
+bool rng_pool_pull(uint64_t *x);
+
+/*******************************************************************************
+* NAME: rng_pool_stats
+* DESC: snapshot of the pool counters
+*******************************************************************************/
+pool_stats_t rng_pool_stats(void);
+
 /*******************************************************************************
 * NAME: rng_hash
 * DESC: integer hashing function
@@ -26,4 +218,91 @@ bool rdrand(uint64_t *x);
 *******************************************************************************/
 uint64_t rng_hash (uint64_t value);
 
+/*******************************************************************************
+* NAME: simd_rng_hash
+* DESC: rng_hash on each 64-bit block, AVX2 has no 64-bit multiply so each one
+*       is made from three 32-bit multiplies
+* OUTP: four unsigned 64-bit hashes
+* @ value : returned blocks are the hashes of the input blocks
+*******************************************************************************/
+__m256i simd_rng_hash(__m256i value);
+
+/*******************************************************************************
+* NAME: rng_health_init
+* DESC: initialize the repetition count and adaptive proportion health tests
+* OUTP: health test state with no samples seen, false positive rate 2^-20
+* @ h : claimed min-entropy per sample, at most 1 if binary else at most 64
+* @ binary : true for rng_health_bits, false for rng_health_words
+*******************************************************************************/
+health_t rng_health_init(const double h, const bool binary);
+
+/*******************************************************************************
+* NAME: rng_health_words
+* DESC: run the health tests over the next n 64-bit samples of a source
+* OUTP: false if either test failed on these samples, state carries over
+* @ src : array of n samples
+*******************************************************************************/
+bool rng_health_words
+(
+    health_t * const health, 
+    const uint64_t * const src, 
+    const size_t n
+);
+
+/*******************************************************************************
+* NAME: rng_health_bits
+* DESC: run the health tests over the next n bits of a binary source
+* OUTP: false if either test failed on these bits, state carries over
+* @ src : binary bit stream of length n bits
+*******************************************************************************/
+bool rng_health_bits
+(
+    health_t * const health, 
+    const uint64_t * const src, 
+    const uint64_t n
+);
+
+#ifdef RNG_INSTRUMENT
+
+/*******************************************************************************
+* NAME: rng_usage_limit
+* DESC: set the fraction of its period after which a generator is reported on
+*       stderr, once per generator. The default is 0.5. Each random_t has a
+*       period of 2^64 draws and each simd_random_t lane a period of 2^32 draws.
+* OUTP: the previous fraction
+* NOTE: call before any generator is in use, a fraction of 0 turns warnings off
+* @ fraction : fraction of the period in [0, 1]
+*******************************************************************************/
+double rng_usage_limit(const double fraction);
+
+/*******************************************************************************
+* NAME: rng_usage_warnings
+* DESC: total generators which have reached the limit of rng_usage_limit
+*******************************************************************************/
+uint64_t rng_usage_warnings(void);
+
+/*******************************************************************************
+* NAME: rng_usage
+* DESC: snapshot of the counters of one sampling function. Words are charged
+*       to every function on the call stack, so a call of rng_bino also counts
+*       its calls of rng_bias.
+* @ api : the sampling function
+*******************************************************************************/
+usage_t rng_usage(const api_t api);
+
+/*******************************************************************************
+* NAME: rng_usage_reset
+* DESC: zero the counters of every sampling function and the warning total
+*******************************************************************************/
+void rng_usage_reset(void);
+
+/*******************************************************************************
+* NAME: rng_usage_report
+* DESC: print calls, words and words per call of every function that was called
+* @ stream : output file such as stdout or stderr
+*******************************************************************************/
+void rng_usage_report(FILE * const stream);
+
+#endif
+
 #endif
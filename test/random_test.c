@@ -87,50 +87,1149 @@ void test_monte_carlo_of_rng_bias_at_256_bits_of_resolution(void)
     }        
 }
 
+/*******************************************************************************
+Give each of the 64 lanes of rng_bias_lanes its own probability (4j + 1)/256 and
+check every lane by monte carlo simulation. The same planes are then broadcast
+into the four 64-bit blocks of the SIMD version, so all 256 lanes are checked.
+*/
+
+void test_monte_carlo_of_rng_bias_lanes_at_256_bits_of_resolution(void)
+{
+    //arrange
+    random_t rng = rng_init(0);
+    assert(rng.state != 0 && "rdrand failure");
+    simd_random_t simd_rng = simd_rng_init(0, 0, 0, 0);
+    
+    uint64_t planes[8] = {0};
+    __m256i simd_planes[8];
+    uint64_t simd_word[4];
+    float results[64] = {0};
+    float simd_results[256] = {0};
+    
+    for (size_t j = 0; j < 64; j++)
+    {
+        uint64_t numerator = 4 * j + 1;
+        
+        for (size_t i = 0; i < 8; i++)
+        {
+            planes[i] |= ((numerator >> i) & 1) << j;
+        }
+    }
+    
+    for (size_t i = 0; i < 8; i++)
+    {
+        simd_planes[i] = _mm256_set1_epi64x((int64_t) planes[i]);
+    }
+    
+    //act
+    for (size_t i = 0; i < MID_SIMULATION; i++)
+    {
+        uint64_t word = rng_bias_lanes(&rng, planes, 8);
+        __m256i vec = simd_rng_bias_lanes(&simd_rng, simd_planes, 8);
+        _mm256_storeu_si256((__m256i *) simd_word, vec);
+        
+        for (size_t j = 0; j < 64; j++)
+        {
+            if ((word >> j) & 1) results[j]++;
+        }
+        
+        for (size_t j = 0; j < 256; j++)
+        {
+            if ((simd_word[j / 64] >> (j % 64)) & 1) simd_results[j]++;
+        }
+    }
+    
+    //assert
+    for (size_t j = 0; j < 256; j++)
+    {
+        float expected = (float) (4 * (j % 64) + 1) / 256.0f;
+        
+        if (j < 64)
+        {
+            results[j] /= MID_SIMULATION;
+            TEST_ASSERT_FLOAT_WITHIN(.005f, expected, results[j]);
+        }
+        
+        simd_results[j] /= MID_SIMULATION;
+        TEST_ASSERT_FLOAT_WITHIN(.005f, expected, simd_results[j]);
+    }
+}
+
+/*******************************************************************************
+Fill a 1000-bit mask from a float array cycling through probabilities 0, .1, 
+.2, ..., .9 and 1. The bits at 0 and 1 must be exact, the others are checked by
+monte carlo simulation. 1000 is not a multiple of 64 so the masked tail is used,
+and the 24 unused bits of the last word must stay cleared.
+*/
+
+void test_monte_carlo_of_simd_rng_bern_float_probabilities(void)
+{
+    //arrange
+    simd_random_t simd_rng = simd_rng_init(0, 0, 0, 0);
+    
+    float p[1000];
+    float results[1000] = {0};
+    uint64_t dest[16];
+    
+    for (size_t i = 0; i < 1000; i++)
+    {
+        p[i] = (float) (i % 11) / 10.0f;
+    }
+    
+    //act
+    for (size_t i = 0; i < SMALL_SIMULATION; i++)
+    {
+        dest[15] = ~0ULL;
+        simd_rng_bern(&simd_rng, p, 1000, dest);
+        TEST_ASSERT_EQUAL_UINT64(0, dest[15] >> 40);
+        
+        for (size_t j = 0; j < 1000; j++)
+        {
+            if ((dest[j / 64] >> (j % 64)) & 1) results[j]++;
+        }
+    }
+    
+    //assert
+    for (size_t i = 0; i < 1000; i++)
+    {
+        results[i] /= SMALL_SIMULATION;
+        
+        if (i % 11 == 0 || i % 11 == 10)
+        {
+            TEST_ASSERT_EQUAL_FLOAT(p[i], results[i]);
+        }
+        else
+        {
+            TEST_ASSERT_FLOAT_WITHIN(.01f, p[i], results[i]);
+        }
+    }
+}
+
+/*******************************************************************************
+rng_kmask on 1000 bits at weights covering the sparse, dense, complemented and
+degenerate paths. Every mask must have exactly k bits and a clear tail, and by
+symmetry each bit of a uniform k-subset is set with probability k/n.
+*/
+
+void test_monte_carlo_of_rng_kmask_exact_weight(void)
+{
+    //arrange
+    random_t rng = rng_init(0);
+    assert(rng.state != 0 && "rdrand failure");
+    
+    const uint64_t weights[6] = {0, 7, 300, 700, 995, 1000};
+    uint64_t dest[16];
+    float results[1000];
+    
+    //act-assert
+    for (size_t w = 0; w < 6; w++)
+    {
+        for (size_t j = 0; j < 1000; j++) results[j] = 0;
+        
+        for (size_t i = 0; i < SMALL_SIMULATION; i++)
+        {
+            uint64_t count = 0;
+            rng_kmask(&rng, dest, 1000, weights[w]);
+            
+            for (size_t j = 0; j < 16; j++)
+            {
+                count += (uint64_t) __builtin_popcountll(dest[j]);
+            }
+            
+            TEST_ASSERT_EQUAL_UINT64(weights[w], count);
+            TEST_ASSERT_EQUAL_UINT64(0, dest[15] >> 40);
+            
+            for (size_t j = 0; j < 1000; j++)
+            {
+                if ((dest[j / 64] >> (j % 64)) & 1) results[j]++;
+            }
+        }
+        
+        for (size_t j = 0; j < 1000; j++)
+        {
+            results[j] /= SMALL_SIMULATION;
+            TEST_ASSERT_FLOAT_WITHIN(.01f, (float) weights[w] / 1000, results[j]);
+        }
+    }
+}
+
+/*******************************************************************************
+The carry-save network in simd_rng_bino must be exact. Two SIMD generators with
+the same seeds are used, and the second counts each simd_rng_bias vector in
+order with a plain popcount, masking the final vector to its lowest bits. 5000
+trials covers one full 4096-trial block, three whole vectors and a partial one.
+*/
+
+void test_simd_rng_bino_matches_direct_popcount(void)
+{
+    //arrange
+    simd_random_t simd_rng_1 = simd_rng_init(1, 2, 3, 4);
+    simd_random_t simd_rng_2 = simd_rng_init(1, 2, 3, 4);
+    
+    const uint64_t trials[4] = {1, 200, 4096, 5000};
+    uint64_t words[4];
+    
+    //act-assert
+    for (size_t i = 0; i < SMALL_SIMULATION; i++)
+    {
+        uint64_t k = trials[i % 4];
+        uint64_t expected = 0;
+        uint64_t result = simd_rng_bino(&simd_rng_1, k, 45, 7);
+        
+        for (uint64_t j = 0; j < k; j += 256)
+        {
+            _mm256_storeu_si256((__m256i *) words, simd_rng_bias(&simd_rng_2, 45, 7));
+            
+            for (uint64_t b = 0; b < 256 && j + b < k; b++)
+            {
+                expected += (words[b / 64] >> (b % 64)) & 1;
+            }
+        }
+        
+        TEST_ASSERT_EQUAL_UINT64(expected, result);
+    }
+}
+
+/*******************************************************************************
+rng_markov with P(0 -> 1) = 1/16 and P(1 -> 0) = 3/16 uses the rng_bias run
+sampler, P(0 -> 1) = 1/4096 and P(1 -> 0) = 1/1024 uses the inversion sampler.
+For both, a stream written in uneven chunks must equal the stream written in one
+call, and over a long stream the fraction of ones and the fraction of ones that
+are followed by a zero should approach p01/(p01 + p10) and p10 respectively.
+*/
+
+void test_monte_carlo_of_rng_markov_bitstream(void)
+{
+    //arrange
+    const uint64_t n01[2] = {1, 1};
+    const int m01[2] = {4, 12};
+    const uint64_t n10[2] = {3, 1};
+    const int m10[2] = {4, 10};
+    const float ones[2] = {.25f, .2f};
+    const float leave[2] = {.1875f, .0009765625f};
+    
+    uint64_t whole[160];
+    uint64_t chunk[32];
+    uint64_t buffer[1024];
+    
+    //act-assert
+    for (size_t c = 0; c < 2; c++)
+    {
+        random_t rng_1 = rng_init(42);
+        random_t rng_2 = rng_init(42);
+        markov_t chain_1 = rng_markov_init(1, n01[c], m01[c], n10[c], m10[c]);
+        markov_t chain_2 = chain_1;
+        
+        rng_markov(&rng_1, &chain_1, whole, 10000);
+        
+        for (uint64_t pos = 0, len = 1; pos < 10000; pos += len, len += 97)
+        {
+            if (len > 10000 - pos) len = 10000 - pos;
+            rng_markov(&rng_2, &chain_2, chunk, len);
+            
+            for (uint64_t i = 0; i < len; i++)
+            {
+                TEST_ASSERT_EQUAL_UINT64
+                (
+                    (whole[(pos + i) / 64] >> ((pos + i) % 64)) & 1,
+                    (chunk[i / 64] >> (i % 64)) & 1
+                );
+            }
+        }
+        
+        float set = 0;
+        float exits = 0;
+        uint64_t last = 0;
+        
+        for (size_t i = 0; i < 1024; i++)
+        {
+            rng_markov(&rng_1, &chain_1, buffer, 65536);
+            
+            for (size_t j = 0; j < 65536; j++)
+            {
+                uint64_t bit = (buffer[j / 64] >> (j % 64)) & 1;
+                if (last && !bit) exits++;
+                set += (float) bit;
+                last = bit;
+            }
+        }
+        
+        TEST_ASSERT_FLOAT_WITHIN(.01f, ones[c], set / (1024 * 65536.0f));
+        TEST_ASSERT_FLOAT_WITHIN(leave[c] * .05f, leave[c], exits / set);
+    }
+}
+
 /*******************************************************************************
 Given an input stream with bits biased to .125 probability of success, output
 a stream of 135 bits with unbiased bits. The input stream has no autocorrelation
 and 135 was selected as a non-multiple of 64.
 */
 
-void test_von_neumann_debiaser_outputs_all_unbiased_bits(void)
+void test_von_neumann_debiaser_outputs_all_unbiased_bits(void)
+{
+    //arrange
+    random_t rng = rng_init(0);
+    assert(rng.state != 0 && "rdrand failure");
+    
+    uint64_t input_stream[35]; //2240 input bits should be enough
+    uint64_t output_stream[3]; //space for 192 but only care about first 135
+    float results[135] = {0}; //holds monte carlo result for each output bit
+    
+    stream_t info;
+    
+    //act-assert
+    for (size_t i = 0; i < MID_SIMULATION; i++)
+    {
+        //populate the input stream with biased bits
+        for (size_t j = 0; j < 35; ++j)
+        {
+            input_stream[j] = rng_bias(&rng, 32, 8);
+        }
+        
+        //populate the output stream with unbiased bits
+        info = rng_vndb(input_stream, output_stream, 2240, 135);
+        TEST_ASSERT_EQUAL_INT(135, info.filled);
+        
+        //walk through the output stream and assess results of this round
+        for (size_t k = 0; k < 135; k++)
+        {
+            if ((output_stream[k/64] >> (k % 64)) & 1) results[k]++;
+        }
+    }
+    
+    //assert
+    for (size_t i = 0; i < 135; ++i)
+    {
+        results[i] /= MID_SIMULATION;
+        TEST_ASSERT_FLOAT_WITHIN(.01f, 0.5f, results[i]);
+    }
+}
+
+/*******************************************************************************
+rng_vndb debiases whole words at a time, so check it against the original bit
+pair walk on random inputs. Lengths and capacities are drawn at random so both
+the source-exhausted and the destination-filled exits are hit, along with caps
+that land mid-word. Every output bit and the stream_t report must match, and
+simd_rng_vndb must produce exactly the same as rng_vndb.
+*/
+
+stream_t vndb_reference
+(
+    const uint64_t *src, 
+    uint64_t *dest, 
+    const uint64_t n, 
+    const uint64_t m
+)
+{
+    stream_t info = {.used = 0, .filled = 0};
+    
+    for (size_t i = 0; i < (m - 1) / 64 + 1; i++) dest[i] = 0;
+    
+    while (info.used < n && info.filled < m)
+    {
+        switch ((src[info.used / 64] >> (info.used % 64)) & 3)
+        {
+            case 1:
+                dest[info.filled / 64] |= 1ULL << (info.filled % 64);
+                info.filled++;
+                break;
+            case 2:
+                info.filled++;
+                break;
+        }
+        
+        info.used += 2;
+    }
+    
+    return info;
+}
+
+void test_von_neumann_debiaser_matches_bit_pair_reference(void)
+{
+    //arrange
+    random_t rng = rng_init(0);
+    assert(rng.state != 0 && "rdrand failure");
+    
+    uint64_t input_stream[64];
+    uint64_t output_stream[64];
+    uint64_t simd_stream[64];
+    uint64_t expected_stream[64];
+    
+    //act-assert
+    for (size_t i = 0; i < SMALL_SIMULATION; i++)
+    {
+        uint64_t n = 2 * rng_rand(&rng, 1, 2048);
+        uint64_t m = rng_rand(&rng, 1, 4096);
+        
+        for (size_t j = 0; j < 64; j++)
+        {
+            input_stream[j] = rng_bias(&rng, rng_rand(&rng, 1, 255), 8);
+            output_stream[j] = rng_next(&rng);
+            simd_stream[j] = output_stream[j];
+        }
+        
+        stream_t expected = vndb_reference(input_stream, expected_stream, n, m);
+        stream_t result = rng_vndb(input_stream, output_stream, n, m);
+        stream_t simd_result = simd_rng_vndb(input_stream, simd_stream, n, m);
+        
+        TEST_ASSERT_EQUAL_UINT64(expected.used, result.used);
+        TEST_ASSERT_EQUAL_UINT64(expected.filled, result.filled);
+        TEST_ASSERT_EQUAL_UINT64_ARRAY(expected_stream, output_stream, (m - 1) / 64 + 1);
+        TEST_ASSERT_EQUAL_UINT64(result.used, simd_result.used);
+        TEST_ASSERT_EQUAL_UINT64(result.filled, simd_result.filled);
+        TEST_ASSERT_EQUAL_UINT64_ARRAY(output_stream, simd_stream, (m - 1) / 64 + 1);
+    }
+}
+
+/*******************************************************************************
+Feed a 20000-bit source through rng_vndb_stream in chunks of random odd and even
+lengths with random output caps, resuming from stream_t.used each time. A 512-bit
+ring is drained after every call, so it wraps many times. The drained output
+must be exactly the one-shot rng_vndb output of the whole source.
+*/
+
+void test_streaming_von_neumann_debiaser_matches_one_shot(void)
+{
+    //arrange
+    random_t rng = rng_init(0);
+    assert(rng.state != 0 && "rdrand failure");
+    
+    uint64_t input_stream[313];
+    uint64_t expected_stream[157];
+    uint64_t output_stream[157] = {0};
+    uint64_t chunk[16];
+    uint64_t ring[8];
+    
+    for (size_t i = 0; i < 313; i++)
+    {
+        input_stream[i] = rng_bias(&rng, 96, 8);
+    }
+    
+    stream_t expected = rng_vndb(input_stream, expected_stream, 20000, 10000);
+    vndb_stream_t ctx = rng_vndb_stream_init(ring, 512);
+    
+    //act
+    uint64_t read = 0;
+    uint64_t tail = 0;
+    
+    while (read < 20000)
+    {
+        uint64_t len = rng_rand(&rng, 1, 1000);
+        uint64_t cap = rng_rand(&rng, 1, 512);
+        if (len > 20000 - read) len = 20000 - read;
+        
+        for (size_t i = 0; i < 16; i++) chunk[i] = 0;
+        
+        for (uint64_t i = 0; i < len; i++)
+        {
+            chunk[i / 64] |= ((input_stream[(read + i) / 64] >> ((read + i) % 64)) & 1) << (i % 64);
+        }
+        
+        stream_t info = rng_vndb_stream(&ctx, chunk, len, cap);
+        TEST_ASSERT_TRUE(info.used == len || info.filled == cap);
+        read += info.used;
+        
+        for (uint64_t i = 0; i < info.filled; i++, tail++)
+        {
+            uint64_t bit = (ring[(tail % 512) / 64] >> (tail % 64)) & 1;
+            output_stream[tail / 64] |= bit << (tail % 64);
+        }
+    }
+    
+    //assert
+    TEST_ASSERT_EQUAL_UINT64(expected.filled, ctx.total);
+    TEST_ASSERT_EQUAL_UINT64(tail % 512, ctx.head);
+    TEST_ASSERT_EQUAL_UINT64_ARRAY(expected_stream, output_stream, (expected.filled - 1) / 64 + 1);
+}
+
+/*******************************************************************************
+Check rng_toep against a bit-by-bit product with the same Toeplitz matrix, whose
+diagonals are the rng_next words of the seed. At h = .5 each 1024-bit block gives
+448 bits, the partial third block is left unused, and a cap of 500 bits stops in
+the second block.
+*/
+
+void test_toeplitz_extractor_matches_matrix_product(void)
+{
+    //arrange
+    random_t rng = rng_init(0);
+    assert(rng.state != 0 && "rdrand failure");
+    random_t matrix = rng_init(42);
+    
+    uint64_t input_stream[34];
+    uint64_t output_stream[32];
+    uint64_t expected_stream[32] = {0};
+    uint64_t t[24];
+    
+    for (size_t i = 0; i < 34; i++) input_stream[i] = rng_bias(&rng, 200, 8);
+    for (size_t i = 0; i < 24; i++) t[i] = rng_next(&matrix);
+    
+    for (size_t b = 0; b < 2; b++)
+    {
+        for (size_t i = 0; i < 448; i++)
+        {
+            uint64_t y = 0;
+            
+            for (size_t j = 0; j < 1024; j++)
+            {
+                size_t d = i - j + 1023;
+                y ^= (input_stream[16 * b + j / 64] >> (j % 64)) 
+                   & (t[d / 64] >> (d % 64)) & 1;
+            }
+            
+            expected_stream[(448 * b + i) / 64] |= y << ((448 * b + i) % 64);
+        }
+    }
+    
+    //act-assert
+    stream_t info = rng_toep(input_stream, output_stream, 2148, 2000, .5, 42);
+    TEST_ASSERT_EQUAL_UINT64(2048, info.used);
+    TEST_ASSERT_EQUAL_UINT64(896, info.filled);
+    TEST_ASSERT_EQUAL_UINT64_ARRAY(expected_stream, output_stream, 32);
+    
+    info = rng_toep(input_stream, output_stream, 2148, 500, .5, 42);
+    TEST_ASSERT_EQUAL_UINT64(2048, info.used);
+    TEST_ASSERT_EQUAL_UINT64(500, info.filled);
+    TEST_ASSERT_EQUAL_UINT64_ARRAY(expected_stream, output_stream, 7);
+    TEST_ASSERT_EQUAL_UINT64(expected_stream[7] & ((1ULL << 52) - 1), output_stream[7]);
+}
+
+/*******************************************************************************
+At depth 1 rng_peres is exactly rng_vndb. At depth 4 every output bit must still
+be unbiased on a .125-biased source, and with 5000 unbiased input bits Peres
+should output far more than the ~1250 bits that Von Neumann alone can.
+*/
+
+void test_peres_debiaser_outputs_more_unbiased_bits(void)
+{
+    //arrange
+    random_t rng = rng_init(0);
+    assert(rng.state != 0 && "rdrand failure");
+    
+    uint64_t input_stream[79];
+    uint64_t output_stream[79];
+    uint64_t expected_stream[79];
+    float results[800] = {0};
+    
+    stream_t expected;
+    stream_t info;
+    
+    //act-assert
+    for (size_t i = 0; i < SMALL_SIMULATION; i++)
+    {
+        for (size_t j = 0; j < 79; j++)
+        {
+            input_stream[j] = rng_bias(&rng, 32, 8);
+        }
+        
+        expected = rng_vndb(input_stream, expected_stream, 5000, 800);
+        info = rng_peres(input_stream, output_stream, 5000, 800, 1);
+        
+        TEST_ASSERT_EQUAL_UINT64(expected.used, info.used);
+        TEST_ASSERT_EQUAL_UINT64(expected.filled, info.filled);
+        TEST_ASSERT_EQUAL_UINT64_ARRAY(expected_stream, output_stream, 13);
+        
+        info = rng_peres(input_stream, output_stream, 5000, 800, 4);
+        TEST_ASSERT_EQUAL_UINT64(800, info.filled);
+        
+        for (size_t k = 0; k < 800; k++)
+        {
+            if ((output_stream[k/64] >> (k % 64)) & 1) results[k]++;
+        }
+        
+        for (size_t j = 0; j < 79; j++)
+        {
+            input_stream[j] = rng_next(&rng);
+        }
+        
+        info = rng_peres(input_stream, output_stream, 5000, 5000, 8);
+        TEST_ASSERT_GREATER_THAN_UINT64(4000, info.filled);
+    }
+    
+    //assert
+    for (size_t i = 0; i < 800; ++i)
+    {
+        results[i] /= SMALL_SIMULATION;
+        TEST_ASSERT_FLOAT_WITHIN(.01f, 0.5f, results[i]);
+    }
+}
+
+/*******************************************************************************
+A seeded PCG stream should pass both health tests as words and as bits. A single
+repeated word, a run of 21 identical bits at H = 1 both inside a word and across
+two words, and a 1110 pattern whose window is three quarters ones should each
+count one failure, while runs of 20 and 11 bits should not.
+*/
+
+void test_health_tests_catch_repeats_and_bias(void)
+{
+    //arrange
+    random_t rng = rng_init(42);
+    health_t words = rng_health_init(64.0, false);
+    health_t bits = rng_health_init(1.0, true);
+    
+    uint64_t stream[64];
+    uint64_t mask = ((1ULL << 20) - 1) << 21;
+    uint64_t base = 0x5555555555555555ULL & ~(1ULL << 20) & ~(1ULL << 41);
+    uint64_t runs[4] = {base | mask, base | (mask << 1), base, base};
+    
+    for (size_t i = 0; i < 64; i++) stream[i] = rng_next(&rng);
+    
+    //act-assert
+    TEST_ASSERT_EQUAL_UINT64(2, words.rct_cutoff);
+    TEST_ASSERT_EQUAL_UINT64(1, words.apt_cutoff);
+    TEST_ASSERT_EQUAL_UINT64(21, bits.rct_cutoff);
+    TEST_ASSERT_EQUAL_UINT64(589, bits.apt_cutoff);
+    
+    TEST_ASSERT_TRUE(rng_health_words(&words, stream, 64));
+    TEST_ASSERT_TRUE(rng_health_bits(&bits, stream, 4096));
+    
+    for (size_t i = 0; i < 64; i++) stream[i] = rng_next(&rng);
+    stream[40] = stream[39];
+    TEST_ASSERT_FALSE(rng_health_words(&words, stream, 64));
+    TEST_ASSERT_EQUAL_UINT64(1, words.failures);
+    
+    runs[2] = 0x5555555555555555ULL | (~0ULL << 54);
+    runs[3] = base | 0x7FF;
+    TEST_ASSERT_FALSE(rng_health_bits(&bits, runs, 256));
+    TEST_ASSERT_EQUAL_UINT64(2, bits.failures);
+    
+    runs[1] = base | mask;
+    runs[3] = base;
+    bits = rng_health_init(1.0, true);
+    TEST_ASSERT_TRUE(rng_health_bits(&bits, runs, 256));
+    
+    for (size_t i = 0; i < 64; i++) stream[i] = 0xEEEEEEEEEEEEEEEFULL;
+    bits = rng_health_init(1.0, true);
+    TEST_ASSERT_FALSE(rng_health_bits(&bits, stream, 1024));
+    TEST_ASSERT_EQUAL_UINT64(1, bits.failures);
+}
+
+/*******************************************************************************
+On a seeded stream where each bit is 1 with probability .75 the min-entropy is
+-log2(.75) = .415 bits. The MCV, collision and markov estimates should land close
+to it, the compression estimate is known to be conservative and should land well
+below it. The multi-threaded driver splits this stream into four chunks and must
+agree with each single estimator exactly.
+*/
+
+void test_entropy_estimators_on_biased_bitstream(void)
+{
+    //arrange
+    random_t rng = rng_init(42);
+    const uint64_t n = 64 * 20000 - 37;
+    uint64_t *stream = malloc(20000 * sizeof(uint64_t));
+    assert(stream != NULL && "malloc failure");
+    
+    for (size_t i = 0; i < 20000; i++) stream[i] = rng_bias(&rng, 192, 8);
+    
+    //act
+    entropy_t entropy = rng_entropy(stream, n, 3);
+    
+    //assert
+    TEST_ASSERT_TRUE(entropy.mcv == rng_entropy_mcv(stream, n));
+    TEST_ASSERT_TRUE(entropy.collision == rng_entropy_collision(stream, n));
+    TEST_ASSERT_TRUE(entropy.markov == rng_entropy_markov(stream, n));
+    TEST_ASSERT_TRUE(entropy.compression == rng_entropy_compression(stream, n));
+    TEST_ASSERT_TRUE(entropy.min == entropy.compression);
+    
+    TEST_ASSERT_FLOAT_WITHIN(.01f, .415f, (float) entropy.mcv);
+    TEST_ASSERT_FLOAT_WITHIN(.01f, .415f, (float) entropy.collision);
+    TEST_ASSERT_FLOAT_WITHIN(.01f, .415f, (float) entropy.markov);
+    TEST_ASSERT_FLOAT_WITHIN(.1f, .3f, (float) entropy.compression);
+    
+    free(stream);
+}
+
+/*******************************************************************************
+The worked examples of SP 800-22 section 2, with bit i of each example string at
+bit i of the stream.
+*/
+
+void test_nist_tests_on_standard_examples(void)
+{
+    //arrange
+    const char *examples[7] =
+    {
+        "1011010101",
+        "0110011010",
+        "1001101011",
+        "11001100000101010110110001001100111000000000001001001101010100010001"
+        "001111010110100000001101011111001100111001101101100010110010",
+        "0011011101",
+        "0100110101",
+        "1011010111"
+    };
+    
+    uint64_t stream[7][2] = {{0}};
+    double serial[2];
+    double cusum[2];
+    
+    for (size_t i = 0; i < 7; i++)
+    {
+        for (size_t j = 0; examples[i][j] != '\0'; j++)
+        {
+            if (examples[i][j] == '1') stream[i][j / 64] |= 1ULL << (j % 64);
+        }
+    }
+    
+    //act
+    rng_nist_serial(stream[4], 10, 3, serial);
+    rng_nist_cusum(stream[6], 10, cusum);
+    
+    double p[7] =
+    {
+        rng_nist_frequency(stream[0], 10),
+        rng_nist_block_frequency(stream[1], 10, 3),
+        rng_nist_runs(stream[2], 10),
+        rng_nist_longest_run(stream[3], 128),
+        rng_nist_approximate_entropy(stream[5], 10, 3),
+        cusum[0],
+        cusum[1]
+    };
+    
+    //assert
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, .527089f, (float) p[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, .801252f, (float) p[1]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, .147232f, (float) p[2]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, .180609f, (float) p[3]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, .261961f, (float) p[4]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, .411659f, (float) p[5]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, .411659f, (float) p[6]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, .808792f, (float) serial[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, .670320f, (float) serial[1]);
+}
+
+/*******************************************************************************
+The threaded battery must report the p-values of the single tests. PCG output
+passes every test while a 51% bias is caught by the frequency based tests.
+*/
+
+void test_nist_battery_on_pcg_and_biased_streams(void)
+{
+    //arrange
+    random_t rng = rng_init(42);
+    const uint64_t n = 64 * 20000 - 37;
+    uint64_t *stream = malloc(20000 * sizeof(uint64_t));
+    double serial[2];
+    double cusum[2];
+    assert(stream != NULL && "malloc failure");
+    
+    for (size_t i = 0; i < 20000; i++) stream[i] = rng_next(&rng);
+    
+    //act
+    nist_t nist = rng_nist(stream, n, 3);
+    rng_nist_serial(stream, n, 16, serial);
+    rng_nist_cusum(stream, n, cusum);
+    double apen = rng_nist_approximate_entropy(stream, n, 10);
+    
+    //assert
+    TEST_ASSERT_TRUE(nist.frequency == rng_nist_frequency(stream, n));
+    TEST_ASSERT_TRUE(nist.block_frequency == rng_nist_block_frequency(stream, n, 12992));
+    TEST_ASSERT_TRUE(nist.runs == rng_nist_runs(stream, n));
+    TEST_ASSERT_TRUE(nist.longest_run == rng_nist_longest_run(stream, n));
+    TEST_ASSERT_TRUE(nist.serial[0] == serial[0]);
+    TEST_ASSERT_TRUE(nist.serial[1] == serial[1]);
+    TEST_ASSERT_TRUE(nist.approximate_entropy == apen);
+    TEST_ASSERT_TRUE(nist.cusum[0] == cusum[0]);
+    TEST_ASSERT_TRUE(nist.cusum[1] == cusum[1]);
+    TEST_ASSERT_TRUE(nist.rank == rng_nist_rank(stream, n));
+    TEST_ASSERT_TRUE(nist.linear_complexity == rng_nist_linear_complexity(stream, n, 500, 1));
+    
+    TEST_ASSERT_TRUE(nist.frequency > .001);
+    TEST_ASSERT_TRUE(nist.block_frequency > .001);
+    TEST_ASSERT_TRUE(nist.runs > .001);
+    TEST_ASSERT_TRUE(nist.longest_run > .001);
+    TEST_ASSERT_TRUE(nist.serial[0] > .001 && nist.serial[1] > .001);
+    TEST_ASSERT_TRUE(nist.approximate_entropy > .001);
+    TEST_ASSERT_TRUE(nist.cusum[0] > .001 && nist.cusum[1] > .001);
+    TEST_ASSERT_TRUE(nist.rank > .001);
+    TEST_ASSERT_TRUE(nist.linear_complexity > .001);
+    
+    for (size_t i = 0; i < 20000; i++) stream[i] = rng_bias(&rng, 33423, 16);
+    
+    nist = rng_nist(stream, n, 3);
+    
+    TEST_ASSERT_TRUE(nist.frequency < .001);
+    TEST_ASSERT_TRUE(nist.cusum[0] < .001 && nist.cusum[1] < .001);
+    TEST_ASSERT_TRUE(nist.runs == 0.0);
+    
+    free(stream);
+}
+
+/*******************************************************************************
+Rank of identity matrices and of a 32 x 32 matrix with one dependent row, and
+the linear complexity of the SP 800-22 example, of a sequence from the LFSR of
+x^20 + x^3 + 1, and of PCG output, which should sit near half its length.
+*/
+
+void test_gf2_rank_and_linear_complexity(void)
+{
+    //arrange
+    random_t rng = rng_init(42);
+    const char *example = "1101011110001";
+    uint64_t rows[64];
+    uint64_t stream[32] = {0};
+    uint64_t bit;
+    
+    for (int i = 0; i < 64; i++) rows[i] = 1ULL << i;
+    
+    for (size_t i = 0; example[i] != '\0'; i++)
+    {
+        if (example[i] == '1') stream[0] |= 1ULL << i;
+    }
+    
+    //act and assert
+    TEST_ASSERT_EQUAL_INT(64, rng_gf2_rank(rows, 64));
+    TEST_ASSERT_EQUAL_INT(32, rng_gf2_rank(rows, 32));
+    
+    for (int i = 0; i < 32; i++) rows[i] = rng_next(&rng) & 0xFFFFFFFF;
+    rows[17] = rows[3] ^ rows[9] ^ rows[30];
+    
+    TEST_ASSERT_TRUE(rng_gf2_rank(rows, 32) <= 31);
+    TEST_ASSERT_EQUAL_UINT64(4, rng_linear_complexity(stream, 13));
+    
+    stream[0] = rng_next(&rng) & 0xFFFFF;
+    
+    for (uint64_t i = 20; i < 2048; i++)
+    {
+        bit = (stream[(i - 3) / 64] >> ((i - 3) % 64)) & 1;
+        bit ^= (stream[(i - 20) / 64] >> ((i - 20) % 64)) & 1;
+        stream[i / 64] |= bit << (i % 64);
+    }
+    
+    TEST_ASSERT_EQUAL_UINT64(20, rng_linear_complexity(stream, 2048));
+    
+    for (size_t i = 0; i < 32; i++) stream[i] = rng_next(&rng);
+    
+    TEST_ASSERT_UINT64_WITHIN(16, 1024, rng_linear_complexity(stream, 2048));
+}
+
+/*******************************************************************************
+Samplers under test for rng_sample_histogram, ctx holds the remaining arguments
+of the call.
+*/
+
+static uint64_t uniform_sampler(random_t * const rng, const void * const ctx)
+{
+    const uint64_t *bounds = ctx;
+    return rng_rand(rng, bounds[0], bounds[1]);
+}
+
+static uint64_t binomial_sampler(random_t * const rng, const void * const ctx)
+{
+    const uint64_t *args = ctx;
+    return rng_bino(rng, args[0], args[1], (int) args[2]);
+}
+
+/*******************************************************************************
+rng_rand on [0, 9] and rng_bino with 20 trials at p = 1/4 should fit their
+distributions, with the binomial tail of 11 or more folded into the last bin. As
+a control, rng_rand on [0, 10] puts 11 values in 10 bins, which both tests must
+reject. The array kernel must count a short stream exactly.
+*/
+
+void test_goodness_of_fit_of_uniform_and_binomial_samplers(void)
+{
+    //arrange
+    const uint64_t uniform[2] = {0, 9};
+    const uint64_t wide[2] = {0, 10};
+    const uint64_t binomial[3] = {20, 1, 2};
+    const uint64_t n = 2 * MID_SIMULATION;
+    random_t rng = rng_init(42);
+    uint64_t counts[3][12] = {{0}};
+    uint64_t samples[997];
+    uint64_t direct[10] = {0};
+    uint64_t reference[10] = {0};
+    uint64_t total = 0;
+    double flat[10];
+    double pmf[12];
+    double tail = 1.0;
+    
+    for (int i = 0; i < 10; i++) flat[i] = 0.1;
+    
+    pmf[0] = 1.0;
+    for (int i = 0; i < 20; i++) pmf[0] *= 0.75;
+    
+    for (int k = 1; k < 11; k++) pmf[k] = pmf[k - 1] * (21.0 - k) / k / 3.0;
+    for (int k = 0; k < 11; k++) tail -= pmf[k];
+    pmf[11] = tail;
+    
+    for (size_t i = 0; i < 997; i++)
+    {
+        samples[i] = rng_rand(&rng, 0, 12);
+        reference[samples[i] < 9 ? samples[i] : 9]++;
+    }
+    
+    //act
+    bool ok = rng_sample_histogram(uniform_sampler, uniform, 1, n, counts[0], 10, 3);
+    ok &= rng_sample_histogram(binomial_sampler, binomial, 2, n, counts[1], 12, 3);
+    ok &= rng_sample_histogram(uniform_sampler, wide, 3, n, counts[2], 10, 3);
+    rng_histogram(samples, 997, direct, 10);
+    
+    fit_t uniform_chi = rng_chi_square(counts[0], flat, 10);
+    fit_t uniform_ks = rng_ks(counts[0], flat, 10);
+    fit_t binomial_chi = rng_chi_square(counts[1], pmf, 12);
+    fit_t binomial_ks = rng_ks(counts[1], pmf, 12);
+    fit_t wide_chi = rng_chi_square(counts[2], flat, 10);
+    fit_t wide_ks = rng_ks(counts[2], flat, 10);
+    
+    //assert
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_EQUAL_UINT64_ARRAY(reference, direct, 10);
+    
+    for (int i = 0; i < 12; i++) total += counts[1][i];
+    TEST_ASSERT_EQUAL_UINT64(n, total);
+    
+    TEST_ASSERT_TRUE(uniform_chi.p > 0.001);
+    TEST_ASSERT_TRUE(uniform_ks.p > 0.001);
+    TEST_ASSERT_TRUE(binomial_chi.p > 0.001);
+    TEST_ASSERT_TRUE(binomial_ks.p > 0.001);
+    TEST_ASSERT_TRUE(wide_chi.p < 1e-6);
+    TEST_ASSERT_TRUE(wide_ks.p < 1e-6);
+}
+
+#ifdef RNG_INSTRUMENT
+
+/*******************************************************************************
+In an instrumented build every draw is counted on its generator and charged to
+each sampling function on the call stack. rng_bias with n = 3 and m = 3 takes
+three words, so rng_bino over 100 trials makes two rng_bias calls on six words.
+With the limit at 2^-28 a simd lane is reported after 16 steps, which prints one
+warning on stderr, while the random_t is far from 2^36 draws.
+*/
+
+void test_instrumented_draw_and_usage_counts(void)
+{
+    //arrange
+    random_t rng = rng_init(42);
+    simd_random_t simd = simd_rng_init(1, 2, 3, 4);
+    const double previous = rng_usage_limit(1.0 / (1 << 28));
+    rng_usage_reset();
+    
+    //act
+    for (int i = 0; i < 10; i++) rng_bias(&rng, 3, 3);
+    rng_bino(&rng, 100, 3, 3);
+    for (int i = 0; i < 10; i++) simd_rng_bias(&simd, 1, 1);
+    
+    usage_t bias = rng_usage(API_RNG_BIAS);
+    usage_t bino = rng_usage(API_RNG_BINO);
+    usage_t simd_bias = rng_usage(API_SIMD_RNG_BIAS);
+    uint64_t warnings = rng_usage_warnings();
+    
+    rng_usage_limit(previous);
+    
+    //assert
+    TEST_ASSERT_EQUAL_UINT64(12, bias.calls);
+    TEST_ASSERT_EQUAL_UINT64(36, bias.words);
+    TEST_ASSERT_EQUAL_UINT64(1, bino.calls);
+    TEST_ASSERT_EQUAL_UINT64(6, bino.words);
+    TEST_ASSERT_EQUAL_UINT64(10, simd_bias.calls);
+    TEST_ASSERT_EQUAL_UINT64(10, simd_bias.words);
+    TEST_ASSERT_EQUAL_UINT64(36, rng.draws);
+    TEST_ASSERT_EQUAL_UINT64(1, warnings);
+    TEST_ASSERT_TRUE(simd_rng_period_used(&simd) == 20.0 / 4294967296.0);
+    TEST_ASSERT_TRUE(rng_period_used(&rng) * 18446744073709551616.0 == 36.0);
+}
+
+#endif
+
+/*******************************************************************************
+simd_rng_init seeded with the similar seeds of speed_test should show no link
+between its lanes. As a control, a copy of lane 0 with a few bits flipped is put
+in lane 3, which the XOR of that pair must expose.
+*/
+
+void test_cross_lane_correlation_of_simd_streams(void)
+{
+    //arrange
+    simd_random_t rng = simd_rng_init(10, 20, 30, 40);
+    const uint64_t words = 4 * 8192;
+    uint64_t *stream = malloc(words * sizeof(uint64_t));
+    nist_t results[11];
+    assert(stream != NULL && "malloc failure");
+    
+    for (uint64_t i = 0; i < words; i += 4)
+    {
+        _mm256_storeu_si256((__m256i *) (stream + i), simd_rng_next(&rng));
+    }
+    
+    //act
+    rng_lanes(stream, words, 4, results, 3);
+    
+    //assert
+    for (size_t i = 0; i < 11; i++)
+    {
+        TEST_ASSERT_TRUE(rng_nist_min(results[i]) > .0001);
+    }
+    
+    for (uint64_t i = 0; i < words; i += 4) stream[i + 3] = stream[i] ^ (1ULL << (i % 61));
+    
+    rng_lanes(stream, words, 4, results, 3);
+    
+    TEST_ASSERT_TRUE(rng_nist_min(results[3]) > .0001);
+    TEST_ASSERT_TRUE(rng_nist_min(results[6]) < .0001);
+    TEST_ASSERT_TRUE(rng_nist_min(results[10]) < .0001);
+    
+    free(stream);
+}
+
+/*******************************************************************************
+Once the refill thread has filled the ring every pull should succeed and seed a
+valid generator, whose two words may or may not come from the pool. Draining the
+ring faster than rdrand can refill it must account for every pull as consumed or
+as an underflow. A stopped pool is never used and does not count as one.
+*/
+
+void test_entropy_pool_refills_and_counts_underflows(void)
 {
     //arrange
+    uint64_t x;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    pool_stats_t stats;
+    
+    TEST_ASSERT_TRUE(rng_pool_start(256, 1, false));
+    TEST_ASSERT_FALSE(rng_pool_start(256, 1, false));
+    
+    do stats = rng_pool_stats(); while (stats.produced < 256);
+    
+    //act-assert
+    for (size_t i = 0; i < 256; i++) TEST_ASSERT_TRUE(rng_pool_pull(&x));
+    
     random_t rng = rng_init(0);
-    assert(rng.state != 0 && "rdrand failure");
+    TEST_ASSERT_TRUE(rng.state != 0 || rng.increment != 0);
     
-    uint64_t input_stream[35]; //2240 input bits should be enough
-    uint64_t output_stream[3]; //space for 192 but only care about first 135
-    float results[135] = {0}; //holds monte carlo result for each output bit
+    for (size_t i = 0; i < 10000; i++)
+    {
+        if (rng_pool_pull(&x)) hits++;
+        else misses++;
+    }
     
-    stream_t info;
+    rng_pool_stop();
+    stats = rng_pool_stats();
+    
+    TEST_ASSERT_EQUAL_UINT64(256 + 2 + 10000, stats.consumed + stats.underflows);
+    TEST_ASSERT_TRUE(stats.consumed >= 256 + hits && stats.consumed <= 258 + hits);
+    TEST_ASSERT_TRUE(stats.underflows >= misses);
+    TEST_ASSERT_FALSE(rng_pool_pull(&x));
+    TEST_ASSERT_EQUAL_UINT64(stats.underflows, rng_pool_stats().underflows);
+    TEST_ASSERT_TRUE(stats.rate > 0.0);
+}
+
+/*******************************************************************************
+Each source in the seeding chain should be usable on its own and report itself,
+the clock fallback must still give distinct streams, and an empty chain should
+fail loudly with a zero state rather than degrade.
+*/
+
+void test_seeding_chain_fallbacks(void)
+{
+    //arrange
+    uint64_t words[100];
+    const int chain = rng_seed_chain(SEED_CLOCK);
     
     //act-assert
-    for (size_t i = 0; i < MID_SIMULATION; i++)
+    random_t rng_1 = rng_init(0);
+    random_t rng_2 = rng_init(0);
+    TEST_ASSERT_TRUE(rng_1.state != rng_2.state);
+    TEST_ASSERT_EQUAL_INT(SEED_CLOCK, rng_seed_words(words, 100));
+    
+    #ifdef __linux__
+        rng_seed_chain(SEED_GETRANDOM);
+        TEST_ASSERT_EQUAL_INT(SEED_GETRANDOM, rng_seed_words(words, 100));
+        TEST_ASSERT_TRUE(words[0] != words[99]);
+    #endif
+    
+    rng_seed_chain(SEED_RDRAND | SEED_CLOCK);
+    TEST_ASSERT_EQUAL_INT(SEED_RDRAND, rng_seed_words(words, 100));
+    
+    rng_seed_chain(0);
+    TEST_ASSERT_EQUAL_INT(0, rng_seed_words(words, 1));
+    rng_1 = rng_init(0);
+    TEST_ASSERT_EQUAL_UINT64(0, rng_1.state);
+    TEST_ASSERT_EQUAL_UINT64(0, rng_1.increment);
+    
+    TEST_ASSERT_EQUAL_INT(0, rng_seed_chain(chain));
+}
+
+/*******************************************************************************
+With rdrand and rdseed masked out the host looks like a VM without them. Both
+must fail instead of trapping, the pool must refuse to start, and the default
+chain must fall through to the next source.
+*/
+
+void test_seeding_chain_skips_missing_instructions(void)
+{
+    //arrange
+    uint64_t words[8];
+    uint64_t x;
+    const int chain = rng_seed_chain(SEED_RDSEED | SEED_RDRAND | SEED_CLOCK);
+    const int hardware = rng_seed_hardware(0);
+    
+    //act-assert
+    TEST_ASSERT_FALSE(rdrand(&x));
+    TEST_ASSERT_FALSE(rdseed(&x));
+    TEST_ASSERT_FALSE(rng_pool_start(64, 1, false));
+    TEST_ASSERT_FALSE(rng_pool_start(64, 1, true));
+    TEST_ASSERT_EQUAL_INT(SEED_CLOCK, rng_seed_words(words, 8));
+    
+    rng_seed_chain(SEED_RDRAND | SEED_GETRANDOM | SEED_CLOCK);
+    random_t rng = rng_init(0);
+    TEST_ASSERT_TRUE(rng.state != 0);
+    
+    TEST_ASSERT_EQUAL_INT(0, rng_seed_hardware(hardware));
+    rng_seed_chain(chain);
+}
+
+/*******************************************************************************
+Bulk initialization should match SplitMix64 word for word, including the scalar
+tail on an odd count, give odd increments, and never repeat a state.
+*/
+
+void test_bulk_initialization_matches_splitmix(void)
+{
+    //arrange
+    const uint64_t gamma = 0x9E3779B97F4A7C15ULL;
+    const uint64_t x = rng_hash(42);
+    random_t *rng = malloc(1001 * sizeof(random_t));
+    simd_random_t simd_rng[3];
+    uint64_t lanes[4];
+    assert(rng != NULL && "malloc failure");
+    
+    //act
+    TEST_ASSERT_TRUE(rng_init_many(42, rng, 1001));
+    TEST_ASSERT_TRUE(simd_rng_init_many(42, simd_rng, 3));
+    
+    //assert
+    for (size_t i = 0; i < 1001; i++)
     {
-        //populate the input stream with biased bits
-        for (size_t j = 0; j < 35; ++j)
+        TEST_ASSERT_EQUAL_UINT64(rng_hash(x + (2 * i + 1) * gamma), rng[i].state);
+        TEST_ASSERT_EQUAL_UINT64(rng_hash(x + (2 * i + 2) * gamma) | 1, rng[i].increment);
+        
+        for (size_t j = 0; j < i; j++) TEST_ASSERT_TRUE(rng[i].state != rng[j].state);
+    }
+    
+    for (size_t i = 0; i < 3; i++)
+    {
+        _mm256_storeu_si256((__m256i *) lanes, simd_rng[i].state);
+        
+        for (size_t j = 0; j < 4; j++)
         {
-            input_stream[j] = rng_bias(&rng, 32, 8);
+            const uint64_t word = rng_hash(x + (8 * i + j + 1) * gamma);
+            TEST_ASSERT_EQUAL_UINT64(word & 0xFFFFFFFF, lanes[j]);
         }
         
-        //populate the output stream with unbiased bits
-        info = rng_vndb(input_stream, output_stream, 2240, 135);
-        TEST_ASSERT_EQUAL_INT(135, info.filled);
+        _mm256_storeu_si256((__m256i *) lanes, simd_rng[i].increment);
         
-        //walk through the output stream and assess results of this round
-        for (size_t k = 0; k < 135; k++)
+        for (size_t j = 0; j < 4; j++)
         {
-            if ((output_stream[k/64] >> (k % 64)) & 1) results[k]++;
+            const uint64_t word = rng_hash(x + (8 * i + j + 5) * gamma);
+            TEST_ASSERT_EQUAL_UINT64((word & 0xFFFFFFFF) | 1, lanes[j]);
         }
     }
     
-    //assert
-    for (size_t i = 0; i < 135; ++i)
-    {
-        results[i] /= MID_SIMULATION;
-        TEST_ASSERT_FLOAT_WITHIN(.01f, 0.5f, results[i]);
-    }
+    free(rng);
 }
 
 /*******************************************************************************
@@ -167,6 +1266,181 @@ void test_cyclic_autocorrelation_of_alternating_bitstream(void)
     }
 }
 
+/*******************************************************************************
+The word-level rng_cycc must agree exactly with the original bit-by-bit version
+on every lag class: word-aligned lags, lags that wrap the final partial word,
+and streams shorter than a single word which wrap more than once per load.
+*/
+
+double cycc_reference(const uint64_t *src, const uint64_t n, const uint64_t k)
+{
+    uint64_t x1 = 0;
+    uint64_t x2 = 0;
+    
+    for (uint64_t i = 0; i < n; i++)
+    {
+        if ((src[i / 64] >> (i % 64)) & 1)
+        {
+            if ((src[(i + k) % n / 64] >> ((i + k) % n % 64)) & 1) x1++;
+            x2++;
+        }
+    }
+    
+    double numerator = (double) n * (double) x1 - (double) x2 * (double) x2;
+    double denominator = (double) n * (double) x2 - (double) x2 * (double) x2;
+    
+    return numerator / denominator;
+}
+
+void test_word_level_cycc_matches_bit_reference(void)
+{
+    //arrange
+    random_t rng = rng_init(42);
+    uint64_t stream[100];
+    const uint64_t lengths[4] = {6400, 6400 - 13, 700, 37};
+    const uint64_t lags[8] = {0, 1, 63, 64, 65, 128, 699, 3000};
+    
+    for (size_t i = 0; i < 100; i++) stream[i] = rng_bias(&rng, 100, 8);
+    
+    //act-assert
+    for (size_t i = 0; i < 4; i++)
+    {
+        for (size_t j = 0; j < 8; j++)
+        {
+            const uint64_t k = lags[j] % lengths[i];
+            const double expected = cycc_reference(stream, lengths[i], k);
+            TEST_ASSERT_TRUE(expected == rng_cycc(stream, lengths[i], k));
+        }
+    }
+}
+
+/*******************************************************************************
+Every lag of rng_cycc_range must match rng_cycc, over a range that spans several
+cache blocks and wraps the final partial word.
+*/
+
+void test_cycc_range_matches_single_lags(void)
+{
+    //arrange
+    random_t rng = rng_init(42);
+    const uint64_t n = 64 * 1500 - 29;
+    uint64_t *stream = malloc(1500 * sizeof(uint64_t));
+    double results[300];
+    assert(stream != NULL && "malloc failure");
+    
+    for (size_t i = 0; i < 1500; i++) stream[i] = rng_bias(&rng, 100, 8);
+    
+    //act
+    rng_cycc_range(stream, n, 0, 299, results);
+    
+    //assert
+    for (uint64_t k = 0; k < 300; k++)
+    {
+        TEST_ASSERT_TRUE(results[k] == rng_cycc(stream, n, k));
+    }
+    
+    rng_cycc_range(stream, n, n - 10, n - 1, results);
+    
+    for (uint64_t k = n - 10; k < n; k++)
+    {
+        TEST_ASSERT_TRUE(results[k - (n - 10)] == rng_cycc(stream, n, k));
+    }
+    
+    free(stream);
+}
+
+/*******************************************************************************
+The threaded cycc must match the serial one exactly on a stream long enough to
+be split into several segments, for lags that straddle segment boundaries and
+wrap around the end.
+*/
+
+void test_threaded_cycc_matches_serial(void)
+{
+    //arrange
+    random_t rng = rng_init(42);
+    const uint64_t words = 300000;
+    const uint64_t n = 64 * words - 17;
+    const uint64_t lags[5] = {0, 1, 63, 64 * 65536 + 5, n - 1};
+    uint64_t *stream = malloc(words * sizeof(uint64_t));
+    uint64_t expected = 0;
+    assert(stream != NULL && "malloc failure");
+    
+    for (size_t i = 0; i < words; i++) stream[i] = rng_bias(&rng, 100, 8);
+    for (size_t i = 0; i < words - 1; i++)
+    {
+        expected += (uint64_t) __builtin_popcountll(stream[i]);
+    }
+    
+    expected += (uint64_t) __builtin_popcountll(stream[words - 1] & (~0ULL >> 17));
+    
+    //act
+    uint64_t total = rng_popcount_mt(stream, n, 4);
+    
+    //assert
+    TEST_ASSERT_EQUAL_UINT64(expected, total);
+    
+    for (size_t i = 0; i < 5; i++)
+    {
+        TEST_ASSERT_TRUE(rng_cycc_mt(stream, n, lags[i], 4) == 
+                         rng_cycc(stream, n, lags[i]));
+    }
+    
+    free(stream);
+}
+
+/*******************************************************************************
+The online accumulator is fed uneven chunks ending on a partial word. It must
+match rng_cycc on the prefix seen so far when queried midway, and on the full
+stream at the end.
+*/
+
+void test_streaming_cycc_matches_whole_stream(void)
+{
+    //arrange
+    random_t rng = rng_init(42);
+    const uint64_t n = 64 * 2000 - 37;
+    const uint64_t lags[8] = {0, 1, 63, 64, 65, 200, 1000, 6400};
+    const uint64_t chunks[5] = {1, 7, 300, 1000, 692};
+    uint64_t *stream = malloc(2000 * sizeof(uint64_t));
+    double results[8];
+    uint64_t pos = 0;
+    assert(stream != NULL && "malloc failure");
+    
+    for (size_t i = 0; i < 2000; i++) stream[i] = rng_bias(&rng, 100, 8);
+    
+    cycc_stream_t ctx = rng_cycc_stream_init(lags, 8);
+    TEST_ASSERT_NOT_NULL(ctx.x1);
+    
+    //act and assert
+    for (size_t i = 0; i < 5; i++)
+    {
+        uint64_t bits = i == 4 ? n - pos * 64 : chunks[i] * 64;
+        rng_cycc_stream(&ctx, stream + pos, bits);
+        pos += chunks[i];
+        
+        if (i == 3)
+        {
+            rng_cycc_stream_result(&ctx, results);
+            
+            for (size_t j = 0; j < 8; j++)
+            {
+                TEST_ASSERT_TRUE(results[j] == rng_cycc(stream, pos * 64, lags[j]));
+            }
+        }
+    }
+    
+    rng_cycc_stream_result(&ctx, results);
+    
+    for (size_t j = 0; j < 8; j++)
+    {
+        TEST_ASSERT_TRUE(results[j] == rng_cycc(stream, n, lags[j]));
+    }
+    
+    rng_cycc_stream_free(&ctx);
+    free(stream);
+}
+
 /*******************************************************************************
 Since the SIMD implemntation is quite tricky, I need to ensure that each 64 bit
 block is actually genreated from an independent PCG stream over two steps. So,
@@ -298,6 +1572,21 @@ void speed_test(void)
     loop { rng_bino(&rng, 64, 1, 8); }
     end_timeit();
     printf("RNG Binomial: %llu us\n", result_timeit(MICROSECONDS));
+    
+    //simd binomial at 4096 trials, one carry-save block
+    start_timeit();
+    loop { simd_rng_bino(&simd_rng, 4096, 1, 8); }
+    end_timeit();
+    printf("SIMD Binomial (4096 Trials): %llu us\n", result_timeit(MICROSECONDS));
+    
+    //bulk initialization of 1 million streams
+    random_t *many = malloc(1000000 * sizeof(random_t));
+    assert(many != NULL && "malloc failure");
+    start_timeit();
+    rng_init_many(50, many, 1000000);
+    end_timeit();
+    printf("Bulk Initialization (1M Streams): %llu us\n", result_timeit(MICROSECONDS));
+    free(many);
 }
 
 /******************************************************************************/
@@ -307,8 +1596,35 @@ int main(void)
     UNITY_BEGIN();
         RUN_TEST(test_deterministic_seed_pcg_output);
         RUN_TEST(test_monte_carlo_of_rng_bias_at_256_bits_of_resolution);
+        RUN_TEST(test_monte_carlo_of_rng_bias_lanes_at_256_bits_of_resolution);
+        RUN_TEST(test_monte_carlo_of_simd_rng_bern_float_probabilities);
+        RUN_TEST(test_monte_carlo_of_rng_kmask_exact_weight);
+        RUN_TEST(test_simd_rng_bino_matches_direct_popcount);
+        RUN_TEST(test_monte_carlo_of_rng_markov_bitstream);
         RUN_TEST(test_von_neumann_debiaser_outputs_all_unbiased_bits);
+        RUN_TEST(test_von_neumann_debiaser_matches_bit_pair_reference);
+        RUN_TEST(test_streaming_von_neumann_debiaser_matches_one_shot);
+        RUN_TEST(test_peres_debiaser_outputs_more_unbiased_bits);
+        RUN_TEST(test_toeplitz_extractor_matches_matrix_product);
+        RUN_TEST(test_health_tests_catch_repeats_and_bias);
+        RUN_TEST(test_entropy_estimators_on_biased_bitstream);
+        RUN_TEST(test_nist_tests_on_standard_examples);
+        RUN_TEST(test_nist_battery_on_pcg_and_biased_streams);
+        RUN_TEST(test_gf2_rank_and_linear_complexity);
+        RUN_TEST(test_cross_lane_correlation_of_simd_streams);
+        RUN_TEST(test_goodness_of_fit_of_uniform_and_binomial_samplers);
+        #ifdef RNG_INSTRUMENT
+            RUN_TEST(test_instrumented_draw_and_usage_counts);
+        #endif
+        RUN_TEST(test_entropy_pool_refills_and_counts_underflows);
+        RUN_TEST(test_seeding_chain_fallbacks);
+        RUN_TEST(test_seeding_chain_skips_missing_instructions);
+        RUN_TEST(test_bulk_initialization_matches_splitmix);
         RUN_TEST(test_cyclic_autocorrelation_of_alternating_bitstream);
+        RUN_TEST(test_word_level_cycc_matches_bit_reference);
+        RUN_TEST(test_cycc_range_matches_single_lags);
+        RUN_TEST(test_threaded_cycc_matches_serial);
+        RUN_TEST(test_streaming_cycc_matches_whole_stream);
         RUN_TEST(test_simd_pcg_32_bit_insecure_generator);
     UNITY_END();
     
@@ -0,0 +1,351 @@
+/*
+* NAME: Copyright (c) 2020, Biren Patel
+* LISC: MIT License
+* DESC: Write raw generator output to stdout for PractRand and TestU01. Output is
+* produced in large aligned blocks, and on Linux it is handed to a pipe reader
+* with vmsplice so that the generator rather than the pipe is the bottleneck.
+*
+* USAGE: rng_stream [-e pcg64|simd] [-s seed] [-l lane] [-b kib] [-n bytes]
+* -e : engine, rng_next (default) or simd_rng_next
+* -s : seed, 0 (default) for non-deterministic seeding
+* -l : write only the 64-bit blocks of one simd_rng_next lane, 0 to 3
+* -b : block size in KiB, default 1024
+* -n : stop after this many bytes, default 0 for unlimited
+*
+* EXAMPLE: rng_stream -e simd -s 42 -l 2 | RNG_test stdin64
+*/
+
+#ifdef __linux__
+    #ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+    #endif
+#endif
+
+#include "random.h"
+
+#include <immintrin.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <unistd.h>
+    #include <sys/stat.h>
+    #include <sys/uio.h>
+#endif
+
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+#endif
+
+#define BLOCKS 3
+
+/*******************************************************************************
+Command line options, see the usage above.
+*/
+
+typedef struct
+{
+    uint64_t seed;
+    uint64_t limit;
+    size_t block;
+    int simd;
+    int lane;
+} options_t;
+
+//static prototypes
+static bool parse(int argc, char **argv, options_t *opt);
+static bool seed(const options_t *opt, random_t *rng, simd_random_t *simd);
+static void fill(const options_t *opt, random_t *rng, simd_random_t *simd, uint64_t *dest);
+static bool emit(const uint8_t *src, size_t n, bool splice);
+static bool pipe_setup(size_t block);
+
+/*******************************************************************************
+Blocks are filled and written in turn. With vmsplice the pipe holds references
+to the pages of a block rather than a copy, so a block can only be refilled once
+the reader has consumed it. The pipe is resized to one block of page aligned
+memory, so by the time a whole block has been spliced every earlier block has
+left the pipe, and a ring of three blocks leaves one spare. A reader that closes
+the pipe is the normal way for a test battery to stop the stream, but any other
+write error is reported and fails the run.
+*/
+
+int main(int argc, char **argv)
+{
+    options_t opt;
+    random_t rng;
+    simd_random_t simd;
+    uint64_t *blocks[BLOCKS];
+    uint64_t written = 0;
+    size_t len;
+    bool splice;
+    int status = EXIT_SUCCESS;
+
+    if (!parse(argc, argv, &opt))
+    {
+        fprintf(stderr, "usage: rng_stream [-e pcg64|simd] [-s seed] [-l lane] ");
+        fprintf(stderr, "[-b kib] [-n bytes]\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!seed(&opt, &rng, &simd))
+    {
+        fprintf(stderr, "rng_stream: seeding failure\n");
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < BLOCKS; i++)
+    {
+        blocks[i] = _mm_malloc(opt.block, 4096);
+
+        if (blocks[i] == NULL)
+        {
+            fprintf(stderr, "rng_stream: out of memory\n");
+            while (i-- > 0) _mm_free(blocks[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    #ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+    #endif
+
+    splice = pipe_setup(opt.block);
+
+    for (int i = 0; opt.limit == 0 || written < opt.limit; i = (i + 1) % BLOCKS)
+    {
+        fill(&opt, &rng, &simd, blocks[i]);
+
+        len = opt.block;
+
+        if (opt.limit != 0 && opt.limit - written < len)
+        {
+            len = (size_t) (opt.limit - written);
+        }
+
+        if (!emit((const uint8_t *) blocks[i], len, splice))
+        {
+            if (errno != EPIPE)
+            {
+                perror("rng_stream");
+                status = EXIT_FAILURE;
+            }
+
+            break;
+        }
+
+        written += len;
+    }
+
+    for (int i = 0; i < BLOCKS; i++) _mm_free(blocks[i]);
+
+    if (status == EXIT_SUCCESS && fflush(stdout) != 0 && errno != EPIPE)
+    {
+        perror("rng_stream");
+        status = EXIT_FAILURE;
+    }
+
+    return status;
+}
+
+/*******************************************************************************
+The simd engine with a single seed uses that seed and the three after it for its
+lanes, so that -e simd -s 42 reproduces simd_rng_init(42, 43, 44, 45). Seed 0
+is non-deterministic for both engines.
+*/
+
+static bool parse
+(
+    int argc,
+    char **argv,
+    options_t *opt
+)
+{
+    char *end;
+    unsigned long long value;
+
+    opt->seed = 0;
+    opt->limit = 0;
+    opt->block = 1024 * 1024;
+    opt->simd = 0;
+    opt->lane = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strlen(argv[i]) != 2 || argv[i][0] != '-' || i + 1 == argc) return false;
+
+        if (argv[i][1] == 'e')
+        {
+            i++;
+
+            if (strcmp(argv[i], "pcg64") == 0) opt->simd = 0;
+            else if (strcmp(argv[i], "simd") == 0) opt->simd = 1;
+            else return false;
+
+            continue;
+        }
+
+        value = strtoull(argv[++i], &end, 0);
+        if (*end != '\0') return false;
+
+        switch (argv[i - 1][1])
+        {
+            case 's':
+                opt->seed = (uint64_t) value;
+                break;
+
+            case 'l':
+                if (value > 3) return false;
+                opt->lane = (int) value;
+                break;
+
+            case 'b':
+                if (value == 0 || value > 1024 * 1024) return false;
+                opt->block = (size_t) value * 1024;
+                break;
+
+            case 'n':
+                opt->limit = (uint64_t) value;
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    return opt->lane < 0 || opt->simd;
+}
+
+/*******************************************************************************
+Only the selected engine is seeded, so that a non-deterministic seed does not
+spend seed words on an unused generator. A zero state and increment is how both
+engines report a seeding failure.
+*/
+
+static bool seed
+(
+    const options_t *opt,
+    random_t *rng,
+    simd_random_t *simd
+)
+{
+    __m256i words;
+
+    if (!opt->simd)
+    {
+        *rng = rng_init(opt->seed);
+        return rng->state != 0 || rng->increment != 0;
+    }
+
+    *simd = simd_rng_init(opt->seed, opt->seed + 1, opt->seed + 2, opt->seed + 3);
+    words = _mm256_or_si256(simd->state, simd->increment);
+
+    return !_mm256_testz_si256(words, words);
+}
+
+/*******************************************************************************
+Each 64-bit block of simd_rng_next holds two consecutive outputs of one lane, so
+a lane is extracted a 64-bit block at a time and its stream stays in order.
+*/
+
+static void fill
+(
+    const options_t *opt,
+    random_t *rng,
+    simd_random_t *simd,
+    uint64_t *dest
+)
+{
+    const size_t words = opt->block / sizeof(uint64_t);
+    uint64_t lanes[4];
+
+    if (!opt->simd)
+    {
+        for (size_t i = 0; i < words; i++) dest[i] = rng_next(rng);
+    }
+    else if (opt->lane < 0)
+    {
+        for (size_t i = 0; i < words; i += 4)
+        {
+            _mm256_store_si256((__m256i *) (dest + i), simd_rng_next(simd));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < words; i++)
+        {
+            _mm256_storeu_si256((__m256i *) lanes, simd_rng_next(simd));
+            dest[i] = lanes[opt->lane];
+        }
+    }
+}
+
+/*******************************************************************************
+Write n bytes to stdout, returning false with errno set if the write fails, which
+is EPIPE once the reader has gone away. Partial writes are resumed until the
+whole block is out.
+*/
+
+static bool emit
+(
+    const uint8_t *src,
+    size_t n,
+    bool splice
+)
+{
+    #ifdef __linux__
+        struct iovec io;
+        ssize_t done;
+
+        while (n > 0)
+        {
+            io.iov_base = (void *) (uintptr_t) src;
+            io.iov_len = n;
+
+            if (splice) done = vmsplice(STDOUT_FILENO, &io, 1, 0);
+            else done = write(STDOUT_FILENO, src, n);
+
+            if (done < 0 && errno == EINTR) continue;
+            if (done == 0) errno = EIO;
+            if (done <= 0) return false;
+
+            src += done;
+            n -= (size_t) done;
+        }
+
+        return true;
+    #else
+        (void) splice;
+        return fwrite(src, 1, n, stdout) == n;
+    #endif
+}
+
+/*******************************************************************************
+vmsplice is only used when stdout is a pipe that can be resized to exactly one
+block, otherwise the ring of blocks would not be safe to reuse. A closed reader
+shows up as an EPIPE error instead of a signal.
+*/
+
+static bool pipe_setup
+(
+    size_t block
+)
+{
+    #ifdef __linux__
+        struct stat info;
+
+        signal(SIGPIPE, SIG_IGN);
+
+        if (fstat(STDOUT_FILENO, &info) != 0 || !S_ISFIFO(info.st_mode)) return false;
+
+        return fcntl(STDOUT_FILENO, F_SETPIPE_SZ, (int) block) == (int) block;
+    #else
+        (void) block;
+        return false;
+    #endif
+}